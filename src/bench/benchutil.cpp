@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2007-2018, GDash Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <cstdio>
+#ifdef G_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include "bench/benchutil.hpp"
+
+
+BenchReport::BenchReport(std::vector<std::string> columns)
+    : columns(std::move(columns)) {
+}
+
+
+void BenchReport::add_row() {
+    rows.push_back(std::vector<Value>());
+}
+
+
+void BenchReport::add(std::string const &value) {
+    g_assert(!rows.empty() && rows.back().size() < columns.size());
+    rows.back().push_back(Value {value, false});
+}
+
+
+void BenchReport::add(double value) {
+    g_assert(!rows.empty() && rows.back().size() < columns.size());
+    /* not locale dependent, so it is always a dot */
+    char buf[G_ASCII_DTOSTR_BUF_SIZE];
+    g_ascii_formatd(buf, sizeof(buf), "%.10g", value);
+    rows.back().push_back(Value {buf, true});
+}
+
+
+static std::string csv_escape(std::string const &s) {
+    if (s.find_first_of(",\"\n") == std::string::npos)
+        return s;
+    std::string escaped = "\"";
+    for (char c : s) {
+        if (c == '"')
+            escaped += '"';
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+
+static std::string json_escape(std::string const &s) {
+    std::string escaped = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if ((unsigned char) c < 0x20) {
+            char buf[8];
+            g_snprintf(buf, sizeof(buf), "\\u%04x", c);
+            escaped += buf;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped + "\"";
+}
+
+
+void BenchReport::write_csv(std::ostream &os) const {
+    for (unsigned c = 0; c < columns.size(); ++c)
+        os << (c > 0 ? "," : "") << csv_escape(columns[c]);
+    os << '\n';
+    for (auto const &row : rows) {
+        for (unsigned c = 0; c < row.size(); ++c)
+            os << (c > 0 ? "," : "") << csv_escape(row[c].text);
+        os << '\n';
+    }
+}
+
+
+void BenchReport::write_json(std::ostream &os) const {
+    os << "[\n";
+    for (unsigned r = 0; r < rows.size(); ++r) {
+        os << "  {";
+        for (unsigned c = 0; c < rows[r].size(); ++c) {
+            Value const &value = rows[r][c];
+            os << (c > 0 ? ", " : "") << json_escape(columns[c]) << ": " << (value.is_number ? value.text : json_escape(value.text));
+        }
+        os << (r + 1 < rows.size() ? "},\n" : "}\n");
+    }
+    os << "]\n";
+}
+
+
+bool BenchReport::write(std::ostream &os, std::string const &format) const {
+    if (format == "csv")
+        write_csv(os);
+    else if (format == "json")
+        write_json(os);
+    else
+        return false;
+    return true;
+}
+
+
+double gd_bench_percentile(std::vector<double> samples, double percentile) {
+    if (samples.empty())
+        return 0;
+    std::sort(samples.begin(), samples.end());
+    double pos = percentile / 100 * (samples.size() - 1);
+    unsigned below = std::min<unsigned>(pos, samples.size() - 1);
+    unsigned above = std::min<unsigned>(below + 1, samples.size() - 1);
+    return samples[below] + (samples[above] - samples[below]) * (pos - below);
+}
+
+
+void gd_bench_reset_peak_memory() {
+#ifdef __linux__
+    /* "5" resets the peak resident set size of the process (linux 4.0+) */
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+#endif
+}
+
+
+unsigned long gd_bench_peak_memory_kib() {
+#ifdef __linux__
+    /* the VmHWM line is the one which can be reset */
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        unsigned long kib;
+        if (std::sscanf(line.c_str(), "VmHWM: %lu kB", &kib) == 1)
+            return kib;
+    }
+#endif
+#ifdef G_OS_UNIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;   /* bytes there */
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2007-2018, GDash Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BENCHUTIL_HPP_INCLUDED
+#define BENCHUTIL_HPP_INCLUDED
+
+#include "config.h"
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+/// @defgroup Benchmarks
+/// Helpers for the benchmark programs: statistics of the measurements,
+/// memory usage and writing the results.
+
+/// @ingroup Benchmarks
+/// @brief The results of a benchmark, as a table which can be written as CSV or JSON.
+/// The values of a row are added in the order of the columns.
+class BenchReport {
+public:
+    explicit BenchReport(std::vector<std::string> columns);
+
+    /// @brief Start a new row.
+    void add_row();
+    /// @brief Add a text value to the current row.
+    void add(std::string const &value);
+    /// @brief Add a numeric value to the current row.
+    void add(double value);
+
+    /// @brief Write the table as CSV, with the column names in the first line.
+    void write_csv(std::ostream &os) const;
+    /// @brief Write the table as a JSON array, which has an object for every row.
+    void write_json(std::ostream &os) const;
+    /// @brief Write the table in the given format, "csv" or "json".
+    /// @return False, if the format is unknown.
+    bool write(std::ostream &os, std::string const &format) const;
+
+private:
+    struct Value {
+        std::string text;
+        bool is_number;
+    };
+    std::vector<std::string> columns;
+    std::vector<std::vector<Value>> rows;
+};
+
+/// @ingroup Benchmarks
+/// @brief The value below which the given percentage of the samples fall.
+/// Interpolates linearly between the nearest samples; 50 gives the median.
+/// @param samples The measurements, in any order.
+/// @param percentile The percentile, 0 to 100.
+double gd_bench_percentile(std::vector<double> samples, double percentile);
+
+/// @ingroup Benchmarks
+/// @brief Reset the peak memory usage of the process, if the system supports it.
+/// On other systems the peak is the one since the start of the process.
+void gd_bench_reset_peak_memory();
+
+/// @ingroup Benchmarks
+/// @brief The peak memory usage (resident set size) of the process, in KiB.
+/// @return The peak, or 0 if it is unknown.
+unsigned long gd_bench_peak_memory_kib();
+
+#endif
@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2007-2018, GDash Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* engine-bench: measures the cave engine on real caves.
+ * for every cave and level of the given cavesets, it times rendering
+ * the map (create_map), playing frames with random input and the
+ * recorded replays (iterate), and producing the drawing indexes for
+ * the screen (draw_indexes). nothing is drawn and nothing is played back;
+ * the results are written as a table of percentiles and throughputs. */
+
+#include "config.h"
+
+#include <glib.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench/benchutil.hpp"
+#include "cave/caveset.hpp"
+#include "cave/cavestored.hpp"
+#include "cave/caverendered.hpp"
+#include "cave/elementproperties.hpp"
+#include "cave/helper/cavereplay.hpp"
+#include "fileops/loadfile.hpp"
+#include "misc/logger.hpp"
+#include "misc/autogfreeptr.hpp"
+#include "settings.hpp"
+
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double seconds_since(BenchClock::time_point start) {
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+
+/* the durations of the calls of one operation, and the number of cells they processed */
+struct EngineSamples {
+    std::vector<double> seconds;
+    double cells = 0;
+
+    void add(double s, int cells_processed) {
+        seconds.push_back(s);
+        cells += cells_processed;
+    }
+    void add(EngineSamples const &other) {
+        seconds.insert(seconds.end(), other.seconds.begin(), other.seconds.end());
+        cells += other.cells;
+    }
+};
+
+
+static BenchReport create_report() {
+    return BenchReport({"caveset", "cave", "level", "input", "operation", "calls", "total_ms",
+                        "p50_us", "p90_us", "p99_us", "max_us", "calls_per_s", "mcells_per_s"});
+}
+
+
+static void report_samples(BenchReport &report, std::string const &caveset, std::string const &cave, int level,
+                           std::string const &input, char const *operation, EngineSamples const &samples) {
+    if (samples.seconds.empty())
+        return;
+    double total = 0;
+    for (double s : samples.seconds)
+        total += s;
+
+    report.add_row();
+    report.add(caveset);
+    report.add(cave);
+    report.add(level);
+    report.add(input);
+    report.add(operation);
+    report.add(samples.seconds.size());
+    report.add(total * 1e3);
+    report.add(gd_bench_percentile(samples.seconds, 50) * 1e6);
+    report.add(gd_bench_percentile(samples.seconds, 90) * 1e6);
+    report.add(gd_bench_percentile(samples.seconds, 99) * 1e6);
+    report.add(gd_bench_percentile(samples.seconds, 100) * 1e6);
+    report.add(total > 0 ? samples.seconds.size() / total : 0);
+    report.add(total > 0 ? samples.cells / total / 1e6 : 0);
+}
+
+
+/* the options of the measurements */
+struct EngineBenchOptions {
+    int frames = 500;
+    int repeat = 5;
+    int levels = 5;
+    int seed = 1;
+    bool replays = true;
+};
+
+
+/* the totals of all caves, by operation */
+struct EngineTotals {
+    EngineSamples create_map, iterate, iterate_replay, draw_indexes;
+};
+
+
+/* plays frames on a cave. every frame is iterated and then drawn, like in the game;
+ * the two are timed separately. */
+class FramePlayer {
+public:
+    FramePlayer(CaveRendered &rendered, EngineSamples &iterate, EngineSamples &draw)
+        : rendered(rendered), iterate(iterate), draw(draw),
+          gfx_buffer(rendered.w, rendered.h, -1), covered(rendered.w, rendered.h, false),
+          cells(rendered.w * rendered.h), frame(0) {
+    }
+
+    void play(GdDirectionEnum &player_move, bool &fire, bool &suicide) {
+        auto start = BenchClock::now();
+        rendered.iterate(player_move, fire, suicide);
+        iterate.add(seconds_since(start), cells);
+
+        start = BenchClock::now();
+        rendered.draw_indexes(gfx_buffer, covered, false, frame % 8, false);
+        draw.add(seconds_since(start), cells);
+        frame++;
+    }
+
+private:
+    CaveRendered &rendered;
+    EngineSamples &iterate, &draw;
+    CaveMap<int> gfx_buffer;
+    CaveMap<bool> covered;
+    int const cells;
+    int frame;
+};
+
+
+static void bench_cave(BenchReport &report, EngineTotals &totals, std::string const &setname, CaveStored &cave, EngineBenchOptions const &options) {
+    for (int level = 0; level < options.levels; ++level) {
+        int const seed = options.seed + level;
+
+        /* rendering the map; the random generator is reset, so every run draws the same map */
+        EngineSamples create_map;
+        {
+            CaveRendered rendered(cave, level, seed);
+            for (int i = 0; i < options.repeat; ++i) {
+                auto start = BenchClock::now();
+                rendered.random.set_seed(seed);
+                rendered.create_map(cave, level);
+                create_map.add(seconds_since(start), rendered.w * rendered.h);
+            }
+        }
+        report_samples(report, setname, cave.name, level + 1, "", "create_map", create_map);
+        totals.create_map.add(create_map);
+
+        /* random input; the same for every run of the program */
+        EngineSamples iterate, draw_indexes;
+        {
+            CaveRendered rendered(cave, level, seed);
+            rendered.setup_for_game();
+            GRand *random = g_rand_new_with_seed(seed);
+            FramePlayer player(rendered, iterate, draw_indexes);
+            for (int frame = 0; frame < options.frames; ++frame) {
+                GdDirectionEnum player_move = GdDirectionEnum(g_rand_int_range(random, MV_STILL, MV_UP_LEFT + 1));
+                bool fire = g_rand_int_range(random, 0, 8) == 0;
+                bool suicide = false;
+                player.play(player_move, fire, suicide);
+            }
+            g_rand_free(random);
+        }
+        report_samples(report, setname, cave.name, level + 1, "random", "iterate", iterate);
+        report_samples(report, setname, cave.name, level + 1, "random", "draw_indexes", draw_indexes);
+        totals.iterate.add(iterate);
+        totals.draw_indexes.add(draw_indexes);
+    }
+
+    /* the recorded replays, played until the end like the replay verifier does */
+    if (!options.replays)
+        return;
+    for (CaveReplay &replay : cave.replays) {
+        EngineSamples iterate, draw_indexes;
+        CaveRendered rendered(cave, replay.level - 1, replay.seed);
+        rendered.setup_for_game();
+        FramePlayer player(rendered, iterate, draw_indexes);
+        gd_cave_play_replay(rendered, replay, [&](GdDirectionEnum &player_move, bool &fire, bool &suicide) {
+            player.play(player_move, fire, suicide);
+        });
+        std::string input = "replay " + std::string(replay.player_name);
+        report_samples(report, setname, cave.name, replay.level, input, "iterate", iterate);
+        report_samples(report, setname, cave.name, replay.level, input, "draw_indexes", draw_indexes);
+        totals.iterate_replay.add(iterate);
+        totals.draw_indexes.add(draw_indexes);
+    }
+}
+
+
+/* collect the caveset files under a directory, whose path relative to it matches the pattern. */
+static void add_caves_from_dir(std::vector<std::string> &files, std::string const &dirname, std::string const &relative, GPatternSpec *pattern) {
+    AutoGFreePtr<char> path(g_build_filename(dirname.c_str(), relative.c_str(), NULL));
+    GDir *dir = g_dir_open(path, 0, NULL);
+    if (!dir)
+        return;
+    std::vector<std::string> names;
+    char const *name;
+    while ((name = g_dir_read_name(dir)) != NULL)
+        names.push_back(name);
+    g_dir_close(dir);
+    /* sorted, so the order of the results is always the same */
+    std::sort(names.begin(), names.end());
+
+    for (std::string const &name : names) {
+        std::string rel = relative.empty() ? name : relative + G_DIR_SEPARATOR_S + name;
+        AutoGFreePtr<char> filename(g_build_filename(dirname.c_str(), rel.c_str(), NULL));
+        if (g_file_test(filename, G_FILE_TEST_IS_DIR)) {
+            add_caves_from_dir(files, dirname, rel, pattern);
+        } else {
+            AutoGFreePtr<char> lower(g_ascii_strdown(filename, -1));
+            if ((g_str_has_suffix(lower, ".bd") || g_str_has_suffix(lower, ".gds")) && g_pattern_match_string(pattern, rel.c_str()))
+                files.push_back((char *) filename);
+        }
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    EngineBenchOptions options;
+    char *caves_pattern = NULL;
+    char *caves_dir = NULL;
+    char *format = NULL;
+    char *output = NULL;
+    gboolean no_replays = FALSE;
+    gboolean no_particles = FALSE;
+    char **caveset_files = NULL;
+
+    GError *error = NULL;
+    GOptionEntry entries[] = {
+        {"caves", 'c', 0, G_OPTION_ARG_STRING, &caves_pattern, "Also measure the cavesets in the caves directory, whose path matches this pattern, eg. \"First_Star_Software/*\""},
+        {"caves-dir", 0, 0, G_OPTION_ARG_FILENAME, &caves_dir, "The caves directory. Default is caves"},
+        {"frames", 'n', 0, G_OPTION_ARG_INT, &options.frames, "Number of frames to play with random input on every level. Default is 500"},
+        {"repeat", 'r', 0, G_OPTION_ARG_INT, &options.repeat, "Number of times to render the map of every level. Default is 5"},
+        {"levels", 'l', 0, G_OPTION_ARG_INT, &options.levels, "Number of levels to measure, 1 to 5. Default is 5"},
+        {"seed", 's', 0, G_OPTION_ARG_INT, &options.seed, "Random seed for the caves and the input. Default is 1"},
+        {"no-replays", 0, 0, G_OPTION_ARG_NONE, &no_replays, "Do not play the replays stored in the cavesets"},
+        {"no-particles", 0, 0, G_OPTION_ARG_NONE, &no_particles, "Disable particle effects"},
+        {"format", 'f', 0, G_OPTION_ARG_STRING, &format, "Output format, csv or json. Default is csv"},
+        {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "Write the results to this file instead of the standard output"},
+        {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &caveset_files, NULL},
+        {NULL}
+    };
+    GOptionContext *context = g_option_context_new("[CAVESET...]");
+    g_option_context_set_summary(context, "Measures the cave engine. The cavesets measured are the ones given, or engine_tests.bd and replays_example.bd.");
+    g_option_context_add_main_entries(context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        std::cerr << error->message << std::endl;
+        return 1;
+    }
+    g_option_context_free(context);
+    std::string const format_name = format != NULL ? format : "csv";
+    if (format_name != "csv" && format_name != "json") {
+        std::cerr << "Unknown output format: " << format_name << std::endl;
+        return 1;
+    }
+    options.frames = std::max(options.frames, 0);
+    options.repeat = std::max(options.repeat, 1);
+    options.levels = CLAMP(options.levels, 1, 5);
+    options.replays = !no_replays;
+
+    std::vector<std::string> files;
+    if (caveset_files != NULL && caveset_files[0] != NULL) {
+        for (char **file = caveset_files; *file != NULL; ++file)
+            files.push_back(*file);
+    } else {
+        files.push_back("engine_tests.bd");
+        files.push_back("replays_example.bd");
+    }
+    g_strfreev(caveset_files);
+    if (caves_pattern != NULL) {
+        GPatternSpec *pattern = g_pattern_spec_new(caves_pattern);
+        add_caves_from_dir(files, caves_dir != NULL ? caves_dir : "caves", "", pattern);
+        g_pattern_spec_free(pattern);
+    }
+
+    Logger global_logger;
+    gd_settings_init();
+    gd_cave_types_init();
+    if (no_particles)
+        gd_particle_effects = false;
+
+    BenchReport report = create_report();
+    EngineTotals totals;
+    for (std::string const &file : files) {
+        CaveSet caveset;
+        try {
+            caveset = load_caveset_from_file(file.c_str());
+        } catch (std::exception &e) {
+            std::cerr << file << ": " << e.what() << std::endl;
+            continue;
+        }
+        std::cerr << file << ": " << caveset.caves.size() << " caves" << std::endl;
+        for (CaveStored &cave : caveset.caves)
+            bench_cave(report, totals, file, cave, options);
+        /* the messages of the engine are not interesting here */
+        global_logger.clear();
+    }
+
+    /* the summary of all caves */
+    report_samples(report, "total", "", 0, "", "create_map", totals.create_map);
+    report_samples(report, "total", "", 0, "random", "iterate", totals.iterate);
+    report_samples(report, "total", "", 0, "replay", "iterate", totals.iterate_replay);
+    report_samples(report, "total", "", 0, "", "draw_indexes", totals.draw_indexes);
+
+    if (output != NULL) {
+        std::ofstream os(output);
+        report.write(os, format_name);
+        if (!os) {
+            std::cerr << output << ": cannot write the results" << std::endl;
+            return 1;
+        }
+    } else {
+        report.write(std::cout, format_name);
+    }
+    return 0;
+}
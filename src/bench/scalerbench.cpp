@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2007-2018, GDash Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* scaler-bench: measures the cost of the scaling settings.
+ * for every theme, scaling type, scaling factor and pal emulation setting,
+ * it times scaling the whole theme image, the pal emulation of the result,
+ * and creating all the cells like the game does. no window is opened;
+ * the pixbufs of the graphics engine are used, and the pixmaps are dummies. */
+
+#include "config.h"
+
+#include <glib.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/benchutil.hpp"
+#include "cave/cavetypes.hpp"
+#include "framework/thememanager.hpp"
+#include "gfx/cellrenderer.hpp"
+#include "gfx/pixbuf.hpp"
+#include "gfx/pixbuffactory.hpp"
+#include "gfx/pixbufmanip.hpp"
+#include "gfx/screen.hpp"
+#include "misc/logger.hpp"
+#include "settings.hpp"
+
+#ifdef HAVE_SDL
+#include "sdl/sdlpixbuffactory.hpp"
+#else
+#include "gtk/gtkpixbuffactory.hpp"
+#endif
+
+#include "c64_gfx.cpp"
+
+
+/* a pixmap which is never drawn, only its size is known. */
+class BenchPixmap : public Pixmap {
+    int w, h;
+public:
+    BenchPixmap(int w, int h) : w(w), h(h) {}
+    virtual int get_width() const {
+        return w;
+    }
+    virtual int get_height() const {
+        return h;
+    }
+};
+
+
+/* a screen without a window. the cell renderer creates the scaled pixbufs
+ * of the cells as usual, but turning them into pixmaps costs nothing. */
+class BenchScreen : public Screen {
+    virtual void configure_size() {}
+public:
+    BenchScreen(PixbufFactory &pixbuf_factory) : Screen(pixbuf_factory) {}
+    virtual void set_title(char const *title) {}
+    virtual std::unique_ptr<Pixmap> create_pixmap_from_pixbuf(Pixbuf const &pb, bool keep_alpha) const {
+        return std::unique_ptr<Pixmap>(new BenchPixmap(pb.get_width(), pb.get_height()));
+    }
+    virtual void fill_rect(int x, int y, int w, int h, const GdColor &c) {}
+    virtual void blit(Pixmap const &src, int dx, int dy) const {}
+    virtual void set_clip_rect(int x1, int y1, int w, int h) {}
+    virtual void remove_clip_rect() {}
+};
+
+
+/* run the function a number of times. it returns the number of pixels
+ * created, and sets the stopwatch to the interesting part of its work. */
+typedef std::function<double(std::chrono::steady_clock::duration &elapsed)> BenchJob;
+
+static void measure(BenchReport &report, std::string const &theme, char const *operation,
+                    GdScalingType scaling_type, double scaling_factor, bool pal_emulation, int repeat, BenchJob const &job) {
+    std::vector<double> seconds;
+    double pixels = 0;
+    gd_bench_reset_peak_memory();
+    for (int i = 0; i < repeat; ++i) {
+        std::chrono::steady_clock::duration elapsed(0);
+        pixels = job(elapsed);
+        seconds.push_back(std::chrono::duration<double>(elapsed).count());
+    }
+    double median = gd_bench_percentile(seconds, 50);
+
+    report.add_row();
+    report.add(theme);
+    report.add(operation);
+    report.add(gd_scaling_names[scaling_type]);
+    report.add(scaling_factor);
+    report.add(pal_emulation ? 1 : 0);
+    report.add(repeat);
+    report.add(median * 1000);
+    report.add(gd_bench_percentile(seconds, 0) * 1000);
+    report.add(median > 0 ? pixels / median / 1e6 : 0);
+    report.add(gd_bench_peak_memory_kib());
+}
+
+
+static std::unique_ptr<Pixbuf> load_theme_image(PixbufFactory &pf, std::string const &theme) {
+    if (theme == "")
+        return pf.create_from_inline(sizeof(c64_gfx), c64_gfx);
+    return pf.create_from_file(theme.c_str());
+}
+
+
+int main(int argc, char *argv[]) {
+    char *factors_list = NULL;
+    char *format = NULL;
+    char *output = NULL;
+    int repeat = 3;
+    char **theme_files = NULL;
+
+    GError *error = NULL;
+    GOptionEntry entries[] = {
+        {"factors", 0, 0, G_OPTION_ARG_STRING, &factors_list, "Comma separated list of scaling factors. Default is 1,2,2.5,3,4"},
+        {"repeat", 'r', 0, G_OPTION_ARG_INT, &repeat, "Number of measurements of every configuration. Default is 3"},
+        {"format", 'f', 0, G_OPTION_ARG_STRING, &format, "Output format, csv or json. Default is csv"},
+        {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "Write the results to this file instead of the standard output"},
+        {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &theme_files, NULL},
+        {NULL}
+    };
+    GOptionContext *context = g_option_context_new("[THEME.PNG...]");
+    g_option_context_set_summary(context, "Measures the scaling algorithms with the built-in graphics, the installed themes and the given theme files.");
+    g_option_context_add_main_entries(context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        std::cerr << error->message << std::endl;
+        return 1;
+    }
+    g_option_context_free(context);
+    std::string const format_name = format != NULL ? format : "csv";
+    if (format_name != "csv" && format_name != "json") {
+        std::cerr << "Unknown output format: " << format_name << std::endl;
+        return 1;
+    }
+    repeat = std::max(repeat, 1);
+
+    std::vector<double> factors;
+    char **factor_strings = g_strsplit(factors_list != NULL ? factors_list : "1,2,2.5,3,4", ",", -1);
+    for (char **s = factor_strings; *s != NULL; ++s) {
+        double factor = g_ascii_strtod(*s, NULL);
+        if (factor > 0)
+            factors.push_back(factor);
+        else
+            std::cerr << "Invalid scaling factor: " << *s << std::endl;
+    }
+    g_strfreev(factor_strings);
+
+    Logger global_logger;
+    gd_settings_init();
+    gd_settings_init_dirs();
+    gd_cave_types_init();
+
+#ifdef HAVE_SDL
+    SDLPixbufFactory pf;
+#else
+    GTKPixbufFactory pf;
+#endif
+    BenchScreen screen(pf);
+
+    /* the built-in theme, the installed ones, then the ones given */
+    std::vector<std::string> themes;
+    int themenum;
+    load_themes_list(pf, themes, themenum);
+    for (char **file = theme_files; file != NULL && *file != NULL; ++file) {
+        if (CellRenderer::is_image_ok_for_theme(pf, *file))
+            themes.push_back(*file);
+        else
+            std::cerr << *file << ": not a theme image, skipped" << std::endl;
+    }
+    g_strfreev(theme_files);
+
+    BenchReport report({"theme", "operation", "scaling", "factor", "pal", "repeat", "median_ms", "min_ms", "mpixels_per_s", "peak_rss_kib"});
+    for (std::string const &theme : themes) {
+        std::string const theme_name = theme != "" ? theme : "builtin";
+        std::unique_ptr<Pixbuf> image = load_theme_image(pf, theme);
+        std::cerr << theme_name << std::endl;
+
+        for (int type = 0; type < GD_SCALING_MAX; ++type) {
+            GdScalingType scaling_type = GdScalingType(type);
+            for (double factor : factors) {
+                /* scaling the whole theme image */
+                measure(report, theme_name, "scale", scaling_type, factor, false, repeat, [&](std::chrono::steady_clock::duration &elapsed) {
+                    auto start = std::chrono::steady_clock::now();
+                    std::unique_ptr<Pixbuf> scaled = pf.create_scaled(*image, factor, scaling_type, false);
+                    elapsed = std::chrono::steady_clock::now() - start;
+                    return double(scaled->get_width()) * scaled->get_height();
+                });
+
+                /* the pal emulation of the scaled image, on a fresh copy every time */
+                std::unique_ptr<Pixbuf> scaled = pf.create_scaled(*image, factor, scaling_type, false);
+                measure(report, theme_name, "pal_emulate", scaling_type, factor, true, repeat, [&](std::chrono::steady_clock::duration &elapsed) {
+                    std::unique_ptr<Pixbuf> copy = pf.create(scaled->get_width(), scaled->get_height());
+                    scaled->copy(*copy, 0, 0);
+                    auto start = std::chrono::steady_clock::now();
+                    pal_emulate(*copy);
+                    elapsed = std::chrono::steady_clock::now() - start;
+                    return double(copy->get_width()) * copy->get_height();
+                });
+                scaled.reset();
+
+                /* all cells of the theme in three versions, like the game creates them */
+                for (int pal = 0; pal <= 1; ++pal) {
+                    measure(report, theme_name, "cell_atlas", scaling_type, factor, pal, repeat, [&](std::chrono::steady_clock::duration &elapsed) {
+                        screen.set_properties(factor, scaling_type, pal);
+                        CellRenderer cells(screen, theme);
+                        /* colorizing the c64 themes is also part of the work */
+                        auto start = std::chrono::steady_clock::now();
+                        cells.prepare_cells();
+                        cells.wait_for_prepared_cells();
+                        double pixels = 0;
+                        for (unsigned i = 0; i < 3 * NUM_OF_CELLS; ++i) {
+                            if (i % NUM_OF_CELLS >= NUM_OF_CELLS_X * NUM_OF_CELLS_Y)
+                                continue;   /* the editor cells */
+                            Pixmap &cell = cells.cell(i);
+                            pixels += double(cell.get_width()) * cell.get_height();
+                        }
+                        elapsed = std::chrono::steady_clock::now() - start;
+                        return pixels;
+                    });
+                }
+            }
+        }
+    }
+
+    if (output != NULL) {
+        std::ofstream os(output);
+        report.write(os, format_name);
+        if (!os) {
+            std::cerr << output << ": cannot write the results" << std::endl;
+            return 1;
+        }
+    } else {
+        report.write(std::cout, format_name);
+    }
+    return 0;
+}
@@ -24,6 +24,8 @@
 #include "config.h"
 
 #include <cstdlib>
+#include <algorithm>
+#include <type_traits>
 
 #include "cave/caverendered.hpp"
 #include "cave/elementproperties.hpp"
@@ -46,7 +48,7 @@ void CaveRendered::set_ckdelay_extra_for_animation() {
     ckdelay_current = 0;
     for (int y = 0; y < height(); y++)
         for (int x = 0; x < width(); x++) {
-            ckdelay_current += gd_element_properties[map(x, y)].ckdelay;
+            ckdelay_current += gd_element_ckdelay[map(x, y)];
             switch (map(x, y)) {
                 case O_FIREFLY_1:
                 case O_FIREFLY_2:
@@ -189,27 +191,27 @@ void CaveRendered::draw_indexes(CaveMap<int> &gfx_buffer, CaveMap<bool> const &c
     }
 
     for (int x = 0; x < O_MAX_INDEX; x++)
-        elemdrawing[x] = gd_element_properties[x].image_game;
+        elemdrawing[x] = gd_element_image_game[x];
     if (bonus_life_flash)
-        elemdrawing[O_SPACE] = gd_element_properties[O_FAKE_BONUS].image_game;
-    elemdrawing[O_MAGIC_WALL] = gd_element_properties[magic_wall_state == GD_MW_ACTIVE ? O_MAGIC_WALL : O_BRICK].image_game;
-    elemdrawing[O_CREATURE_SWITCH] = gd_element_properties[creatures_backwards ? O_CREATURE_SWITCH_ON : O_CREATURE_SWITCH].image_game;
-    elemdrawing[O_EXPANDING_WALL_SWITCH] = gd_element_properties[expanding_wall_changed ? O_EXPANDING_WALL_SWITCH_VERT : O_EXPANDING_WALL_SWITCH_HORIZ].image_game;
-    elemdrawing[O_GRAVITY_SWITCH] = gd_element_properties[gravity_switch_active ? O_GRAVITY_SWITCH_ACTIVE : O_GRAVITY_SWITCH].image_game;
-    elemdrawing[O_REPLICATOR_SWITCH] = gd_element_properties[replicators_active ? O_REPLICATOR_SWITCH_ON : O_REPLICATOR_SWITCH_OFF].image_game;
+        elemdrawing[O_SPACE] = gd_element_image_game[O_FAKE_BONUS];
+    elemdrawing[O_MAGIC_WALL] = gd_element_image_game[magic_wall_state == GD_MW_ACTIVE ? O_MAGIC_WALL : O_BRICK];
+    elemdrawing[O_CREATURE_SWITCH] = gd_element_image_game[creatures_backwards ? O_CREATURE_SWITCH_ON : O_CREATURE_SWITCH];
+    elemdrawing[O_EXPANDING_WALL_SWITCH] = gd_element_image_game[expanding_wall_changed ? O_EXPANDING_WALL_SWITCH_VERT : O_EXPANDING_WALL_SWITCH_HORIZ];
+    elemdrawing[O_GRAVITY_SWITCH] = gd_element_image_game[gravity_switch_active ? O_GRAVITY_SWITCH_ACTIVE : O_GRAVITY_SWITCH];
+    elemdrawing[O_REPLICATOR_SWITCH] = gd_element_image_game[replicators_active ? O_REPLICATOR_SWITCH_ON : O_REPLICATOR_SWITCH_OFF];
     if (!replicators_active)
         /* if the replicators are inactive, do not animate them. */
         elemdrawing[O_REPLICATOR] = abs(elemdrawing[O_REPLICATOR]);
-    elemdrawing[O_CONVEYOR_SWITCH] = gd_element_properties[conveyor_belts_active ? O_CONVEYOR_SWITCH_ON : O_CONVEYOR_SWITCH_OFF].image_game;
+    elemdrawing[O_CONVEYOR_SWITCH] = gd_element_image_game[conveyor_belts_active ? O_CONVEYOR_SWITCH_ON : O_CONVEYOR_SWITCH_OFF];
     if (conveyor_belts_direction_changed) {
         /* if direction is changed, animation is changed. */
         int temp = elemdrawing[O_CONVEYOR_LEFT];
         elemdrawing[O_CONVEYOR_LEFT] = elemdrawing[O_CONVEYOR_RIGHT];
         elemdrawing[O_CONVEYOR_RIGHT] = temp;
 
-        elemdrawing[O_CONVEYOR_DIR_SWITCH] = gd_element_properties[O_CONVEYOR_DIR_CHANGED].image_game;
+        elemdrawing[O_CONVEYOR_DIR_SWITCH] = gd_element_image_game[O_CONVEYOR_DIR_CHANGED];
     } else
-        elemdrawing[O_CONVEYOR_DIR_SWITCH] = gd_element_properties[O_CONVEYOR_DIR_NORMAL].image_game;
+        elemdrawing[O_CONVEYOR_DIR_SWITCH] = gd_element_image_game[O_CONVEYOR_DIR_NORMAL];
     if (!conveyor_belts_active) {
         /* if they are not running, do not animate them. */
         elemdrawing[O_CONVEYOR_LEFT] = abs(elemdrawing[O_CONVEYOR_LEFT]);
@@ -225,21 +227,21 @@ void CaveRendered::draw_indexes(CaveMap<int> &gfx_buffer, CaveMap<bool> const &c
     int draw;
     if (last_direction == MV_STILL) { /* player is idle. */
         if (player_blinking && player_tapping)
-            draw = gd_element_properties[O_PLAYER_TAP_BLINK].image_game;
+            draw = gd_element_image_game[O_PLAYER_TAP_BLINK];
         else if (player_blinking)
-            draw = gd_element_properties[O_PLAYER_BLINK].image_game;
+            draw = gd_element_image_game[O_PLAYER_BLINK];
         else if (player_tapping)
-            draw = gd_element_properties[O_PLAYER_TAP].image_game;
+            draw = gd_element_image_game[O_PLAYER_TAP];
         else
-            draw = gd_element_properties[O_PLAYER].image_game;
+            draw = gd_element_image_game[O_PLAYER];
     } else if (last_direction == MV_UP && gd_alternate_vertical_animation)
-        draw = gd_element_properties[O_PLAYER_UP].image_game;
+        draw = gd_element_image_game[O_PLAYER_UP];
     else if (last_direction == MV_DOWN && gd_alternate_vertical_animation)
-        draw = gd_element_properties[O_PLAYER_DOWN].image_game;
+        draw = gd_element_image_game[O_PLAYER_DOWN];
     else if (last_horizontal_direction == MV_LEFT)
-        draw = gd_element_properties[O_PLAYER_LEFT].image_game;
+        draw = gd_element_image_game[O_PLAYER_LEFT];
     else /* mv_right */
-        draw = gd_element_properties[O_PLAYER_RIGHT].image_game;
+        draw = gd_element_image_game[O_PLAYER_RIGHT];
     elemdrawing[O_PLAYER] = draw;
     elemdrawing[O_PLAYER_GLUED] = draw;
     /* player with bomb/rocketlauncher does not blink or tap - no graphics drawn for that.
@@ -248,9 +250,9 @@ void CaveRendered::draw_indexes(CaveMap<int> &gfx_buffer, CaveMap<bool> const &c
         elemdrawing[O_PLAYER_BOMB] = draw;
         elemdrawing[O_PLAYER_ROCKET_LAUNCHER] = draw;
     }
-    elemdrawing[O_INBOX] = gd_element_properties[inbox_flash_toggle ? O_OUTBOX_OPEN : O_OUTBOX_CLOSED].image_game;
-    elemdrawing[O_OUTBOX] = gd_element_properties[inbox_flash_toggle ? O_OUTBOX_OPEN : O_OUTBOX_CLOSED].image_game;
-    elemdrawing[O_BITER_SWITCH] = gd_element_properties[O_BITER_SWITCH].image_game + biter_delay_frame; /* hack, cannot do this with gd_element_properties */
+    elemdrawing[O_INBOX] = gd_element_image_game[inbox_flash_toggle ? O_OUTBOX_OPEN : O_OUTBOX_CLOSED];
+    elemdrawing[O_OUTBOX] = gd_element_image_game[inbox_flash_toggle ? O_OUTBOX_OPEN : O_OUTBOX_CLOSED];
+    elemdrawing[O_BITER_SWITCH] = gd_element_image_game[O_BITER_SWITCH] + biter_delay_frame; /* hack, cannot do this with gd_element_properties */
     /* visual effects */
     elemdrawing[O_DIRT] = elemdrawing[dirt_looks_like];
     elemdrawing[O_EXPANDING_WALL] = elemdrawing[expanding_wall_looks_like];
@@ -269,7 +271,7 @@ void CaveRendered::draw_indexes(CaveMap<int> &gfx_buffer, CaveMap<bool> const &c
             int draw;
 
             if (covered(x, y))          /* if covered, real element is not important */
-                draw = gd_element_properties[O_COVERED].image_game;
+                draw = gd_element_image_game[O_COVERED];
             else
                 draw = elemdrawing[map(x, y)];
             if ((last_direction == MV_LEFT || last_direction == MV_RIGHT)
@@ -306,6 +308,103 @@ int CaveRendered::time_visible(int internal_time) const {
     return (internal_time + timing_factor - 1) / timing_factor;
 }
 
+/// Call func for every variable of the cave, which may change while the cave is iterated.
+/// The maps and the random number generator of the cave are not visited. All variables
+/// are plain old data, so they can be saved and restored by copying their bytes.
+template <typename FUNC>
+void CaveRendered::for_each_state_variable(FUNC func) {
+    /* changed by iterate() in the CaveBase part */
+    func(diamond_value); func(amoeba_growth_prob); func(amoeba_2_growth_prob);
+    func(biter_delay_frame); func(expanding_wall_changed); func(replicators_active);
+    func(conveyor_belts_active); func(conveyor_belts_direction_changed);
+    func(creatures_backwards); func(gravity); func(gravity_switch_active);
+
+    /* game variables of the rendered cave */
+    func(c64_rand);
+    func(hatched); func(gate_open); func(speed); func(ckdelay);
+    func(hatching_delay_frame); func(hatching_delay_time); func(time_bonus); func(time_penalty);
+    func(time); func(time_elapsed); func(timevalue);
+    func(diamonds_needed); func(diamonds_collected); func(skeletons_collected); func(gate_open_flash);
+    func(amoeba_time); func(amoeba_2_time); func(amoeba_max_count); func(amoeba_2_max_count);
+    func(amoeba_state); func(convert_amoeba_this_frame); func(amoeba_2_state);
+    func(magic_wall_time); func(slime_permeability); func(slime_permeability_c64); func(magic_wall_state);
+    func(player_state); func(player_seen_ago); func(kill_player); func(sweet_eaten);
+    func(player_x); func(player_y); func(player_x_mem); func(player_y_mem);
+    func(key1); func(key2); func(key3); func(diamond_key_collected); func(inbox_flash_toggle);
+    func(biters_wait_frame); func(replicators_wait_frame); func(creatures_direction_will_change);
+    func(gravity_will_change); func(gravity_disabled); func(gravity_next_direction);
+    func(got_pneumatic_hammer); func(pneumatic_hammer_active_delay);
+    func(last_direction); func(last_horizontal_direction); func(player_blinking); func(player_tapping);
+    func(voodoo_touched);
+    func(sound1); func(sound2); func(sound3);
+    func(score); func(ckdelay_current); func(ckdelay_extra_for_animation);
+}
+
+
+/// Save the state of the cave during the game into a byte array.
+/// The state consists of the cave map, the hammered walls map and the variables
+/// visited by for_each_state_variable(); the random number generator is not
+/// included, that can be copied separately. For the same cave, the state is
+/// always of the same size, and the same byte positions store the same data,
+/// so states can be compared byte by byte.
+void CaveRendered::save_state(std::vector<guint8> &state) const {
+    CaveRendered &cave = const_cast<CaveRendered &>(*this);     /* for_each_state_variable only reads here */
+    state.clear();
+    auto append = [&state](void const *p, size_t size) {
+        state.insert(state.end(), static_cast<guint8 const *>(p), static_cast<guint8 const *>(p) + size);
+    };
+
+    for (int y = 0; y < map.height(); y++)
+        for (int x = 0; x < map.width(); x++) {
+            guint16 element = map(x, y);
+            append(&element, sizeof(element));
+        }
+    for (int y = 0; y < hammered_reappear.height(); y++)
+        for (int x = 0; x < hammered_reappear.width(); x++)
+            append(&hammered_reappear(x, y), sizeof(int));
+    cave.for_each_state_variable([&append](auto &var) {
+        static_assert(std::is_trivially_copyable<typename std::remove_reference<decltype(var)>::type>::value, "state variables must be plain old data");
+        append(&var, sizeof(var));
+    });
+}
+
+
+/// Restore the state of the cave saved by save_state().
+/// Particles are removed, and the engine checks the whole map again in the next iterate(),
+/// as if the cave was just created.
+/// @param state The bytes created by save_state() of this cave, or a copy of this cave.
+void CaveRendered::load_state(std::vector<guint8> const &state) {
+    size_t pos = 0;
+    auto read = [&state, &pos](void *p, size_t size) {
+        g_assert(pos + size <= state.size());
+        std::copy(state.begin() + pos, state.begin() + pos + size, static_cast<guint8 *>(p));
+        pos += size;
+    };
+
+    for (int y = 0; y < map.height(); y++)
+        for (int x = 0; x < map.width(); x++) {
+            guint16 element;
+            read(&element, sizeof(element));
+            map(x, y) = GdElementEnum(element);
+        }
+    for (int y = 0; y < hammered_reappear.height(); y++)
+        for (int x = 0; x < hammered_reappear.width(); x++)
+            read(&hammered_reappear(x, y), sizeof(int));
+    for_each_state_variable([&read](auto &var) {
+        read(&var, sizeof(var));
+    });
+    g_assert(pos == state.size());
+
+    particles.clear();
+    postprocess_cells.clear();
+    postprocess_whole_map = true;
+    active_segments.clear();
+    player_cells.clear();
+    teleporter_cells.clear();
+    amoeba_food.clear();
+}
+
+
 /// Calculate adler checksum for a rendered cave; this can be used for more caves.
 void gd_cave_adler_checksum_more(const CaveRendered &cave, unsigned &a, unsigned &b) {
     for (int y = 0; y < cave.h; y++) {
@@ -362,6 +461,70 @@ int gd_cave_check_replays(CaveStored &cave, bool report, bool remove, bool repai
     return wrong;
 }
 
+/// Play a replay on a rendered cave, frame by frame, the same way GameControl does when showing it:
+/// iterating stops when the player exits, at a timeout, when fire is pressed
+/// after the player died, or some frames after the recorded movements run out.
+/// The replay is rewound before and after playing.
+/// @param rendered The cave rendered with the level and seed of the replay, already set up for the game.
+/// @param replay The replay to play.
+/// @param play_frame Called with the movements of every frame; it must iterate the cave.
+/// @return The number of frames played.
+int gd_cave_play_replay(CaveRendered &rendered, CaveReplay &replay, ReplayFrameFunction const &play_frame) {
+    int frames = 0, no_more_movements = 0;
+    replay.rewind();
+    while (rendered.player_state != GD_PL_TIMEOUT && rendered.player_state != GD_PL_EXITED) {
+        GdDirectionEnum player_move = MV_STILL;
+        bool fire = false, suicide = false;
+
+        if (!replay.get_next_movement(player_move, fire, suicide))
+            no_more_movements++;
+
+        play_frame(player_move, fire, suicide);
+        frames++;
+
+        /* the game also iterates a few frames after the last movement; it starts covering
+         * the cave after the 16th one, but that frame is still iterated. */
+        if (no_more_movements > 15)
+            break;
+        /* pressing fire after dying restarts the cave, so the replay ends there. */
+        if (rendered.player_state == GD_PL_DIED && fire)
+            break;
+    }
+    replay.rewind();
+    return frames;
+}
+
+/// Play a replay at full engine speed, without drawing, sound or timing.
+/// @param cave The cave the replay belongs to.
+/// @param replay The replay to play; it is rewound before and after playing.
+/// @return The result of the playback, compared to the values recorded in the replay.
+ReplayVerifyResult gd_cave_verify_replay(CaveStored const &cave, CaveReplay &replay) {
+    ReplayVerifyResult result;
+
+    /* -1 is because level=1 is in bdcff for level 1, and internally we number levels from 0 */
+    CaveRendered rendered(cave, replay.level - 1, replay.seed);
+    GdInt checksum = gd_cave_adler_checksum(rendered);
+    result.checksum_ok = replay.checksum == 0 || checksum == replay.checksum;
+    rendered.setup_for_game();
+
+    int score = 0;
+    int frames = gd_cave_play_replay(rendered, replay, [&](GdDirectionEnum &player_move, bool &fire, bool &suicide) {
+        rendered.iterate(player_move, fire, suicide);
+        score += rendered.score;
+    });
+
+    /* remaining time is converted to points, one second at a time */
+    if (rendered.player_state == GD_PL_EXITED)
+        score += rendered.time_visible(rendered.time) * rendered.timevalue;
+
+    result.success = rendered.player_state == GD_PL_EXITED;
+    result.score = score;
+    result.diamonds = rendered.diamonds_collected;
+    result.frames = frames;
+    result.matches = result.checksum_ok && result.success == bool(replay.success) && result.score == replay.score;
+    return result;
+}
+
 
 /// Put an element to the specified position.
 /// Performs range checking.
@@ -27,7 +27,9 @@
 #include "config.h"
 
 #include <glib.h>
+#include <functional>
 #include <list>
+#include <vector>
 
 #include "cave/cavebase.hpp"
 #include "cave/helper/caverandom.hpp"
@@ -37,6 +39,7 @@
 
 class CaveStored;
 class CaveObject;
+class CaveReplay;
 
 /// These are states of the magic wall.
 /// @todo ezt nem kéne plainolddatába rakni?
@@ -90,6 +93,7 @@ private:
     bool explodes_by_hit(int x, int y, GdDirectionEnum dir) const;
     bool non_explodable(int x, int y) const;
     bool amoeba_eats(int x, int y, GdDirectionEnum dir) const;
+    bool amoeba_can_grow(int x, int y);
     bool sloped(int x, int y, GdDirectionEnum dir, GdDirectionEnum slop) const;
     bool sloped_for_bladder(int x, int y, GdDirectionEnum dir) const;
     bool blows_up_flies(int x, int y, GdDirectionEnum dir) const;
@@ -114,8 +118,22 @@ private:
     void move(int x, int y, GdDirectionEnum dir, GdElementEnum element);
     void next(int x, int y);
     void unscan(int x, int y);
+    void set_active(int index);
+    void add_teleporter(int index);
+    void count_amoeba_food();
+    void amoeba_food_changed(int index, GdElementEnum old_element, GdElementEnum new_element);
+    int active_segments_per_row() const;
     
     void update_scheduling();
+    template <typename FUNC> void for_each_state_variable(FUNC func);
+
+    std::vector<Coordinate> postprocess_cells;  ///< cells which may be left scanned, or hold a time penalty, after the scan of iterate()
+    bool postprocess_whole_map = true;          ///< the map was not created by iterate(), so every cell must be checked after the first scan
+    enum { ActiveSegmentWidth = 16 };
+    std::vector<unsigned char> active_segments; ///< for every ActiveSegmentWidth cells of each row, false if they are all inert, so iterate() can skip them
+    std::vector<int> player_cells;              ///< map indexes of the players, and of the cells where a player was stored since the last iterate()
+    std::vector<int> teleporter_cells;          ///< sorted map indexes of the teleporters, and of the cells where one was destroyed since the last iterate()
+    std::vector<guint8> amoeba_food;            ///< for every cell, the number of neighbours an amoeba could eat; empty until the first amoeba is checked
 
 public:
     CaveRendered(CaveStored const &cave, int level, int seed);
@@ -124,6 +142,8 @@ public:
     void setup_for_game();
     void count_diamonds();
     void set_ckdelay_extra_for_animation();
+    void save_state(std::vector<guint8> &state) const;
+    void load_state(std::vector<guint8> const &state);
 
     /* game playing helpers */
     void draw_indexes(CaveMap<int> &gfx_buffer, CaveMap<bool> const &covered, bool bonus_life_flash, int animcycle, bool hate_invisible_outbox);
@@ -213,7 +233,7 @@ public:
     GdBool voodoo_touched;
 
     SoundWithPos sound1, sound2, sound3;        ///< sound set for 3 channels after each iteration
-    std::list<ParticleSet> particles;
+    ParticleSystem particles;
     GdColor dirt_particle_color, dirt_2_particle_color, diamond_particle_color,
             stone_particle_color, mega_stone_particle_color,
             explosion_particle_color, magic_wall_particle_color, expanding_wall_particle_color,
@@ -229,5 +249,21 @@ unsigned gd_cave_adler_checksum(const CaveRendered &cave);
 void gd_cave_adler_checksum_more(const CaveRendered &cave, unsigned &a, unsigned &b);
 int gd_cave_check_replays(CaveStored &cave, bool report, bool remove, bool repair);
 
+/// The outcome of a replay played back without screen, sound and timer.
+struct ReplayVerifyResult {
+    bool checksum_ok;       ///< the cave rendered with the seed of the replay has the recorded checksum
+    bool success;           ///< the player exited the cave
+    int score;              ///< score collected, including the bonus points for the remaining time
+    int diamonds;           ///< number of diamonds collected
+    int frames;             ///< number of cave iterations played
+    bool matches;           ///< the checksum is right, and success and score are the same as recorded
+};
+
+/// Called by gd_cave_play_replay for every frame; it must iterate the cave with the movement given.
+typedef std::function<void(GdDirectionEnum &player_move, bool &fire, bool &suicide)> ReplayFrameFunction;
+
+int gd_cave_play_replay(CaveRendered &rendered, CaveReplay &replay, ReplayFrameFunction const &play_frame);
+ReplayVerifyResult gd_cave_verify_replay(CaveStored const &cave, CaveReplay &replay);
+
 #endif
 
@@ -24,6 +24,7 @@
 #include "config.h"
 
 #include <cmath>
+#include <algorithm>
 
 #include "cave/caverendered.hpp"
 #include "cave/elementproperties.hpp"
@@ -43,6 +44,42 @@ static GdDirection const opposite[] = { MV_STILL, MV_DOWN, MV_DOWN_LEFT, MV_LEFT
 // doubling a direction (e.g. right=1,0   2x right=2,0
 static GdDirection const twice[] = { MV_STILL, MV_UP_2, MV_UP_RIGHT_2, MV_RIGHT_2, MV_DOWN_RIGHT_2, MV_DOWN_2, MV_DOWN_LEFT_2, MV_LEFT_2, MV_UP_LEFT_2 };
 
+// elements which do nothing when the scan loop of iterate() reaches them.
+// none of them has a case in the big switch there, and none of them has a
+// ckdelay, so the loop can skip them, and even whole segments of a row
+// which contain nothing else (see active_segments).
+// an element which gets a case in that switch must be removed from here!
+static GdElementEnum const inert_elements[] = {
+    O_SPACE, O_DIRT, O_DIRT2, O_DIRT_GLUED,
+    O_DIRT_SLOPED_UP_RIGHT, O_DIRT_SLOPED_UP_LEFT, O_DIRT_SLOPED_DOWN_LEFT, O_DIRT_SLOPED_DOWN_RIGHT,
+    O_BRICK, O_BRICK_NON_SLOPED, O_BRICK_EATABLE,
+    O_BRICK_SLOPED_UP_RIGHT, O_BRICK_SLOPED_UP_LEFT, O_BRICK_SLOPED_DOWN_LEFT, O_BRICK_SLOPED_DOWN_RIGHT,
+    O_STEEL, O_STEEL_EXPLODABLE, O_STEEL_EATABLE,
+    O_STEEL_SLOPED_UP_RIGHT, O_STEEL_SLOPED_UP_LEFT, O_STEEL_SLOPED_DOWN_LEFT, O_STEEL_SLOPED_DOWN_RIGHT,
+    O_OUTBOX, O_INVIS_OUTBOX,
+    O_EXPANDING_WALL_SWITCH, O_CREATURE_SWITCH, O_BITER_SWITCH, O_REPLICATOR_SWITCH,
+    O_CONVEYOR_SWITCH, O_CONVEYOR_DIR_SWITCH, O_GRAVITY_SWITCH,
+    O_BOX, O_TIME_PENALTY, O_GRAVESTONE, O_STONE_GLUED, O_DIAMOND_GLUED, O_DIAMOND_KEY, O_CLOCK,
+    O_KEY_1, O_KEY_2, O_KEY_3, O_DOOR_1, O_DOOR_2, O_DOOR_3,
+    O_WALLED_DIAMOND, O_WALLED_KEY_1, O_WALLED_KEY_2, O_WALLED_KEY_3,
+    O_POT, O_PNEUMATIC_HAMMER, O_TELEPORTER, O_SKELETON, O_SWEET, O_VOODOO,
+    O_PLAYER_GLUED, O_ROCKET_LAUNCHER, O_BOMB,
+    O_UNKNOWN, O_NONE,
+};
+
+// the inert_elements list as a bitmask, so the scan loop can check it with a single test.
+static class InertElementMask {
+    unsigned bits[(O_MAX_INDEX + 31) / 32];
+public:
+    InertElementMask() : bits() {
+        for (GdElementEnum e : inert_elements)
+            bits[e / 32] |= 1u << (e % 32);
+    }
+    bool operator[](GdElementEnum e) const {
+        return (bits[e / 32] >> (e % 32)) & 1;
+    }
+} const inert_element;
+
 
 void CaveRendered::add_particle_set(int x, int y, GdElementEnum particletype) {
     if (!gd_particle_effects)
@@ -55,67 +92,67 @@ void CaveRendered::add_particle_set(int x, int y, GdElementEnum particletype) {
     double gx = gd_dx[gravity], gy = gd_dy[gravity], agx = fabs(gx), agy = fabs(gy);
     switch (particletype) {
         case O_DIRT:
-            particles.push_back(ParticleSet(75, 0.1, 0.15, x + 0.5, y + 0.5, 0.5, 0.5, 0, 0, 1, 1, dirt_particle_color));
+            particles.add(75, 0.1, 0.15, x + 0.5, y + 0.5, 0.5, 0.5, 0, 0, 1, 1, dirt_particle_color);
             break;
         case O_DIRT2:
-            particles.push_back(ParticleSet(75, 0.1, 0.15, x + 0.5, y + 0.5, 0.5, 0.5, 0, 0, 1, 1, dirt_2_particle_color));
+            particles.add(75, 0.1, 0.15, x + 0.5, y + 0.5, 0.5, 0.5, 0, 0, 1, 1, dirt_2_particle_color);
             break;
         case O_STONE_F:
-            particles.push_back(ParticleSet(75, 0.1, 0.15,
-                                            x + 0.5 + 0.5 * gx, y + 0.5 + 0.5 * gy, 0.25 + 0.25 * agy, 0.25 + 0.25 * agx,
-                                            0.5 * gx, 0.5 * gy, 1 + agy, 1 + agx, stone_particle_color));
+            particles.add(75, 0.1, 0.15,
+                          x + 0.5 + 0.5 * gx, y + 0.5 + 0.5 * gy, 0.25 + 0.25 * agy, 0.25 + 0.25 * agx,
+                          0.5 * gx, 0.5 * gy, 1 + agy, 1 + agx, stone_particle_color);
             break;
         case O_MEGA_STONE_F:
-            particles.push_back(ParticleSet(75, 0.1, 0.15,
-                                            x + 0.5 + 0.5 * gx, y + 0.5 + 0.5 * gy, 0.25 + 0.25 * agy, 0.25 + 0.25 * agx,
-                                            0.5 * gx, 0.5 * gy, 1 + agy, 1 + agx, mega_stone_particle_color));
+            particles.add(75, 0.1, 0.15,
+                          x + 0.5 + 0.5 * gx, y + 0.5 + 0.5 * gy, 0.25 + 0.25 * agy, 0.25 + 0.25 * agx,
+                          0.5 * gx, 0.5 * gy, 1 + agy, 1 + agx, mega_stone_particle_color);
             break;
         case O_DIAMOND_F:
             /* falling diamond */
-            particles.push_back(ParticleSet(15, 0.03, 0.5,
-                                            x + 0.5 + 0.5 * gx, y + 0.5 + 0.5 * gy, 0.25, 0.25,
-                                            0, 0, 2, 2, diamond_particle_color));
+            particles.add(15, 0.03, 0.5,
+                          x + 0.5 + 0.5 * gx, y + 0.5 + 0.5 * gy, 0.25, 0.25,
+                          0, 0, 2, 2, diamond_particle_color);
             break;
         case O_DIAMOND:
             /* collecting diamond */
-            particles.push_back(ParticleSet(8, 0.03, 0.5,
-                                            x + 0.5, y + 0.5, 0.25, 0.25,
-                                            0, 0, 2, 2, diamond_particle_color));
+            particles.add(8, 0.03, 0.5,
+                          x + 0.5, y + 0.5, 0.25, 0.25,
+                          0, 0, 2, 2, diamond_particle_color);
             break;
         case O_EXPLODE_1:
             /* for explosions, the original place of the particles is a 2x2 cave cell area, but they
              * expand rapidly. */
-            particles.push_back(ParticleSet(300, 0.05, 0.5, x + 0.5, y + 0.5, 1.0, 1.0, 0, 0, 4, 4, explosion_particle_color));
+            particles.add(300, 0.05, 0.5, x + 0.5, y + 0.5, 1.0, 1.0, 0, 0, 4, 4, explosion_particle_color);
             break;
         case O_PRE_DIA_1:
-            particles.push_back(ParticleSet(300, 0.05, 0.5, x + 0.5, y + 0.5, 1.0, 1.0, 0, 0, 4, 4, diamond_particle_color));
+            particles.add(300, 0.05, 0.5, x + 0.5, y + 0.5, 1.0, 1.0, 0, 0, 4, 4, diamond_particle_color);
             break;
         case O_MAGIC_WALL:
             // a magic wall creates particles in every frame. so add only very few particles!
             // rather they should be bright like stars
-            particles.push_back(ParticleSet(3, 0.01, 0.75, x + 0.5, y + 0.5, 0.5, 0.5, 0, 0, 1 + 2 * agx, 1 + 2 * agy, magic_wall_particle_color));
+            particles.add(3, 0.01, 0.75, x + 0.5, y + 0.5, 0.5, 0.5, 0, 0, 1 + 2 * agx, 1 + 2 * agy, magic_wall_particle_color);
             break;
         case O_EXPANDING_WALL:
-            particles.push_back(ParticleSet(75, 0.1, 0.15, x + 0.5, y + 0.5, 0.5, 0.5, 0, 0, 1, 1, expanding_wall_particle_color));
+            particles.add(75, 0.1, 0.15, x + 0.5, y + 0.5, 0.5, 0.5, 0, 0, 1, 1, expanding_wall_particle_color);
             break;
         case O_EXPANDING_STEEL_WALL:
-            particles.push_back(ParticleSet(75, 0.1, 0.15, x + 0.5, y + 0.5, 0.5, 0.5, 0, 0, 1, 1, expanding_steel_wall_particle_color));
+            particles.add(75, 0.1, 0.15, x + 0.5, y + 0.5, 0.5, 0.5, 0, 0, 1, 1, expanding_steel_wall_particle_color);
             break;
         case O_LAVA:
             // this should look like it's boiling
-            particles.push_back(ParticleSet(10, 0.01, 0.5, x + 0.5, y + 0.5, 0.5, 0.5, 0, 0, 2, 2, lava_particle_color));
+            particles.add(10, 0.01, 0.5, x + 0.5, y + 0.5, 0.5, 0.5, 0, 0, 2, 2, lava_particle_color);
             break;
         case O_ROCKET_1:
-            particles.push_back(ParticleSet(100, 0.03, 0.25, x + 0.9, y + 0.5, 0.5, 0.2, -4, 0.2, 3, 0.2, explosion_particle_color));
+            particles.add(100, 0.03, 0.25, x + 0.9, y + 0.5, 0.5, 0.2, -4, 0.2, 3, 0.2, explosion_particle_color);
             break;
         case O_ROCKET_2:
-            particles.push_back(ParticleSet(100, 0.03, 0.25, x + 0.5, y + 0.1, 0.2, 0.5, 0.2, 4, 0.2, 3, explosion_particle_color));
+            particles.add(100, 0.03, 0.25, x + 0.5, y + 0.1, 0.2, 0.5, 0.2, 4, 0.2, 3, explosion_particle_color);
             break;
         case O_ROCKET_3:
-            particles.push_back(ParticleSet(100, 0.03, 0.25, x + 0.1, y + 0.5, 0.5, 0.2, 4, 0.2, 3, 0.2, explosion_particle_color));
+            particles.add(100, 0.03, 0.25, x + 0.1, y + 0.5, 0.5, 0.2, 4, 0.2, 3, 0.2, explosion_particle_color);
             break;
         case O_ROCKET_4:
-            particles.push_back(ParticleSet(100, 0.03, 0.25, x + 0.5, y + 0.9, 0.2, 0.5, 0.2, -4, 0.2, 3, explosion_particle_color));
+            particles.add(100, 0.03, 0.25, x + 0.5, y + 0.9, 0.2, 0.5, 0.2, -4, 0.2, 3, explosion_particle_color);
             break;
         default:
             break;
@@ -517,17 +554,26 @@ inline GdElementEnum CaveRendered::get(int x, int y, GdDirectionEnum dir) const
 
 /// Returns true, if element at (x,y)+dir explodes if hit by a stone (for example, a firefly).
 inline bool CaveRendered::explodes_by_hit(int x, int y, GdDirectionEnum dir) const {
-    return (gd_element_properties[get(x, y, dir)].flags & P_EXPLODES_BY_HIT) != 0;
+    return (gd_element_flags[get(x, y, dir)] & P_EXPLODES_BY_HIT) != 0;
 }
 
 /// returns true, if the element is not explodable (for example the steel wall).
 inline bool CaveRendered::non_explodable(int x, int y) const {
-    return (gd_element_properties[get(x, y)].flags & P_NON_EXPLODABLE) != 0;
+    return (gd_element_flags[get(x, y)] & P_NON_EXPLODABLE) != 0;
 }
 
 /// returns true, if the element at (x,y)+dir can be eaten by the amoeba (dirt, space)
 inline bool CaveRendered::amoeba_eats(int x, int y, GdDirectionEnum dir) const {
-    return (gd_element_properties[get(x, y, dir)].flags & P_AMOEBA_CONSUMES) != 0;
+    return (gd_element_flags[get(x, y, dir)] & P_AMOEBA_CONSUMES) != 0;
+}
+
+/// Returns true, if an amoeba at (x,y) could grow in any direction.
+/// Gives the same result as amoeba_eats() for the four directions, but it is only
+/// a lookup in the counts kept up to date by the routines which change the map.
+inline bool CaveRendered::amoeba_can_grow(int x, int y) {
+    if (amoeba_food.empty())
+        count_amoeba_food();
+    return amoeba_food[map.index_of(map(x, y))] != 0;
 }
 
 /// Returns true if the element is sloped, so stones and diamonds roll down on it.
@@ -541,13 +587,13 @@ inline bool CaveRendered::amoeba_eats(int x, int y, GdDirectionEnum dir) const {
 bool CaveRendered::sloped(int x, int y, GdDirectionEnum dir, GdDirectionEnum slop) const {
     switch (slop) {
         case MV_LEFT:
-            return (gd_element_properties[get(x, y, dir)].flags & P_SLOPED_LEFT) != 0;
+            return (gd_element_flags[get(x, y, dir)] & P_SLOPED_LEFT) != 0;
         case MV_RIGHT:
-            return (gd_element_properties[get(x, y, dir)].flags & P_SLOPED_RIGHT) != 0;
+            return (gd_element_flags[get(x, y, dir)] & P_SLOPED_RIGHT) != 0;
         case MV_UP:
-            return (gd_element_properties[get(x, y, dir)].flags & P_SLOPED_UP) != 0;
+            return (gd_element_flags[get(x, y, dir)] & P_SLOPED_UP) != 0;
         case MV_DOWN:
-            return (gd_element_properties[get(x, y, dir)].flags & P_SLOPED_DOWN) != 0;
+            return (gd_element_flags[get(x, y, dir)] & P_SLOPED_DOWN) != 0;
         default:
             break;
     }
@@ -557,53 +603,53 @@ bool CaveRendered::sloped(int x, int y, GdDirectionEnum dir, GdDirectionEnum slo
 
 /// returns true if the element is sloped for bladder movement (brick=yes, diamond=no, for example)
 inline bool CaveRendered::sloped_for_bladder(int x, int y, GdDirectionEnum dir) const {
-    return (gd_element_properties[get(x, y, dir)].flags & P_BLADDER_SLOPED) != 0;
+    return (gd_element_flags[get(x, y, dir)] & P_BLADDER_SLOPED) != 0;
 }
 
 /// returns true if the element at (x,y)+dir can blow up a fly by touching it.
 inline bool CaveRendered::blows_up_flies(int x, int y, GdDirectionEnum dir) const {
-    return (gd_element_properties[get(x, y, dir)].flags & P_BLOWS_UP_FLIES) != 0;
+    return (gd_element_flags[get(x, y, dir)] & P_BLOWS_UP_FLIES) != 0;
 }
 
 /// returns true if the element is a counter-clockwise creature
 inline bool CaveRendered::rotates_ccw(int x, int y) const {
-    return (gd_element_properties[get(x, y)].flags & P_CCW) != 0;
+    return (gd_element_flags[get(x, y)] & P_CCW) != 0;
 }
 
 /// returns true if the element is a player (normal player, player glued, player with bomb)
 bool CaveRendered::is_player(int x, int y) const {
-    return (gd_element_properties[get(x, y)].flags & P_PLAYER) != 0;
+    return (gd_element_flags[get(x, y)] & P_PLAYER) != 0;
 }
 
 /// returns true if the element at (x,y)+dir is a player (normal player, player glued, player with bomb)
 bool CaveRendered::is_player(int x, int y, GdDirectionEnum dir) const {
-    return (gd_element_properties[get(x, y, dir)].flags & P_PLAYER) != 0;
+    return (gd_element_flags[get(x, y, dir)] & P_PLAYER) != 0;
 }
 
 /// returns true if the element at (x,y)+dir can be hammered.
 inline bool CaveRendered::can_be_hammered(int x, int y, GdDirectionEnum dir) const {
-    return (gd_element_properties[get(x, y, dir)].flags & P_CAN_BE_HAMMERED) != 0;
+    return (gd_element_flags[get(x, y, dir)] & P_CAN_BE_HAMMERED) != 0;
 }
 
 /// Returns true if the element at (x,y)+dir can be pushed.
 /// @todo should be inlined.
 bool CaveRendered::can_be_pushed(int x, int y, GdDirectionEnum dir) const {
-    return (gd_element_properties[get(x, y, dir)].flags & P_CAN_BE_PUSHED) != 0;
+    return (gd_element_flags[get(x, y, dir)] & P_CAN_BE_PUSHED) != 0;
 }
 
 /// returns true if the element at (x,y) is the first animation stage of an explosion
 inline bool CaveRendered::is_first_stage_of_explosion(int x, int y) const {
-    return (gd_element_properties[get(x, y)].flags & P_EXPLOSION_FIRST_STAGE) != 0;
+    return (gd_element_flags[get(x, y)] & P_EXPLOSION_FIRST_STAGE) != 0;
 }
 
 /// returns true if the element sits on and is moved by the conveyor belt
 inline bool CaveRendered::moved_by_conveyor_top(int x, int y, GdDirectionEnum dir) const {
-    return (gd_element_properties[get(x, y, dir)].flags & P_MOVED_BY_CONVEYOR_TOP) != 0;
+    return (gd_element_flags[get(x, y, dir)] & P_MOVED_BY_CONVEYOR_TOP) != 0;
 }
 
 /// returns true if the elements floats upwards, and is conveyed by the conveyor belt which is OVER it
 inline bool CaveRendered::moved_by_conveyor_bottom(int x, int y, GdDirectionEnum dir) const {
-    return (gd_element_properties[get(x, y, dir)].flags & P_MOVED_BY_CONVEYOR_BOTTOM) != 0;
+    return (gd_element_flags[get(x, y, dir)] & P_MOVED_BY_CONVEYOR_BOTTOM) != 0;
 }
 
 /// returns true if the element is a scanned one (needed by the engine)
@@ -631,9 +677,9 @@ bool CaveRendered::is_like_element(int x, int y, GdDirectionEnum dir, GdElementE
     int examined = get(x, y, dir);
 
     /* if it is a dirt-like, change to dirt, so equality will evaluate to true */
-    if (gd_element_properties[examined].flags & P_DIRT)
+    if (gd_element_flags[examined] & P_DIRT)
         examined = O_DIRT;
-    if (gd_element_properties[e].flags & P_DIRT)
+    if (gd_element_flags[e] & P_DIRT)
         e = O_DIRT;
     /* if the element on the map is a lava, it should be like space */
     if (examined == O_LAVA)
@@ -665,7 +711,7 @@ inline bool CaveRendered::is_like_space(int x, int y, GdDirectionEnum dir) const
 /// (without exploding).
 /// Therefore 'if (map(x,y)==O_DIRT)' must not be used!
 inline bool CaveRendered::is_like_dirt(int x, int y, GdDirectionEnum dir) const {
-    return (gd_element_properties[get(x, y, dir)].flags & P_DIRT) != 0;
+    return (gd_element_flags[get(x, y, dir)] & P_DIRT) != 0;
 }
 
 
@@ -673,13 +719,26 @@ inline bool CaveRendered::is_like_dirt(int x, int y, GdDirectionEnum dir) const
 /// If there is a lava originally at the given position, sound is played, and
 /// the map is NOT changed.
 /// The element given is changed to its "scanned" state, if there is such.
+/// Cells which might need to be unscanned or turned into a gravestone
+/// after the scan are remembered, so iterate() does not have to check the whole map.
 inline void CaveRendered::store(int x, int y, GdElementEnum element, bool disable_particle) {
     GdElementEnum &cell = map(x, y);
     if (cell == O_LAVA) {
         play_effect_of_element(O_LAVA, x, y);
         return;
     }
+    GdElementEnum const old_element = cell;
     cell = scanned_pair(element);
+    if (!amoeba_food.empty())
+        amoeba_food_changed(map.index_of(cell), old_element, cell);
+    if (is_scanned_element(cell) || cell == O_TIME_PENALTY)
+        postprocess_cells.push_back(Coordinate(x, y));
+    if (!inert_element[cell])
+        set_active(map.index_of(cell));
+    if (gd_element_flags[element] & P_PLAYER)
+        player_cells.push_back(map.index_of(cell));
+    if (cell == O_TELEPORTER)
+        add_teleporter(map.index_of(cell));
 }
 
 
@@ -735,14 +794,87 @@ inline void CaveRendered::move(int x, int y, GdDirectionEnum dir, GdElementEnum
 /// increment a cave element; can be used for elements which are one after the other, for example bladder1, bladder2, bladder3...
 /// @todo to be removed
 inline void CaveRendered::next(int x, int y) {
-    map(x, y) = GdElementEnum(map(x, y) + 1);
+    GdElementEnum &cell = map(x, y);
+    cell = GdElementEnum(cell + 1);
+    if (!amoeba_food.empty())
+        amoeba_food_changed(map.index_of(cell), GdElementEnum(cell - 1), cell);
+    if (is_scanned_element(cell))
+        postprocess_cells.push_back(Coordinate(x, y));
+    if (!inert_element[cell])
+        set_active(map.index_of(cell));
+    if (gd_element_flags[nonscanned_pair(cell)] & P_PLAYER)
+        player_cells.push_back(map.index_of(cell));
+    if (cell == O_TELEPORTER)
+        add_teleporter(map.index_of(cell));
 }
 
 /// Remove th scanned "bit" from an element.
 /// To be called only for scanned elements!!!
 inline void CaveRendered::unscan(int x, int y) {
-    if (is_scanned(x, y))
-        map(x, y) = gd_element_properties[get(x, y)].pair;
+    GdElementEnum &cell = map(x, y);
+    if (is_scanned_element(cell)) {
+        GdElementEnum const old_element = cell;
+        cell = GdElementEnum(gd_element_pair[cell]);
+        if (!amoeba_food.empty())
+            amoeba_food_changed(map.index_of(cell), old_element, cell);
+        set_active(map.index_of(cell));
+    }
+}
+
+
+/// Remember that a teleporter was put to the cell with the given index.
+inline void CaveRendered::add_teleporter(int index) {
+    auto it = std::lower_bound(teleporter_cells.begin(), teleporter_cells.end(), index);
+    if (it == teleporter_cells.end() || *it != index)
+        teleporter_cells.insert(it, index);
+}
+
+
+/// Count the neighbours an amoeba could eat, for every cell of the map.
+/// This is done when an amoeba is checked for the first time on a map;
+/// from then on, the routines which change the map keep the counts up to date.
+void CaveRendered::count_amoeba_food() {
+    amoeba_food.assign(w * h, 0);
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            amoeba_food[y * w + x] = amoeba_eats(x, y, MV_UP) + amoeba_eats(x, y, MV_DOWN)
+                                     + amoeba_eats(x, y, MV_LEFT) + amoeba_eats(x, y, MV_RIGHT);
+}
+
+
+/// Update the amoeba food counts of the neighbours of the cell with the given index,
+/// after it changed from old_element to new_element.
+inline void CaveRendered::amoeba_food_changed(int index, GdElementEnum old_element, GdElementEnum new_element) {
+    bool const was_food = (gd_element_flags[old_element] & P_AMOEBA_CONSUMES) != 0;
+    bool const is_food = (gd_element_flags[new_element] & P_AMOEBA_CONSUMES) != 0;
+    if (was_food == is_food)
+        return;
+    /* being neighbours is symmetric for every wrap type, so the cells
+     * which see this one as their neighbour are its own neighbours. */
+    int const x = index % w, y = index / w;
+    static GdDirectionEnum const dirs[] = { MV_UP, MV_DOWN, MV_LEFT, MV_RIGHT };
+    for (GdDirectionEnum dir : dirs) {
+        guint8 &food = amoeba_food[map.index_of(map(x + gd_dx[dir], y + gd_dy[dir]))];
+        if (is_food)
+            food++;
+        else
+            food--;
+    }
+}
+
+
+/// Remember that the segment of the map containing the cell with the given index
+/// has an element which is not inert, so the scan loop of iterate() must visit it.
+inline void CaveRendered::set_active(int index) {
+    unsigned segment = index / w * active_segments_per_row() + index % w / ActiveSegmentWidth;
+    if (segment < active_segments.size())
+        active_segments[segment] = true;
+}
+
+
+/// The number of segments a row of the map is divided into by active_segments.
+inline int CaveRendered::active_segments_per_row() const {
+    return (w + ActiveSegmentWidth - 1) / ActiveSegmentWidth;
 }
 
 
@@ -1146,27 +1278,22 @@ GdElementEnum CaveRendered::player_eat_element(GdElementEnum element, int x, int
    @return True, if the player is teleported, false, if no suitable teleporter found.
  */
 bool CaveRendered::do_teleporter(int px, int py, GdDirectionEnum player_move) {
-    int tx = px;
-    int ty = py;
-    bool teleported = false;
-    do {
-        /* jump to next element; wrap around columns and rows. */
-        tx++;
-        if (tx >= w) {
-            tx = 0;
-            ty++;
-            if (ty >= h)
-                ty = 0;
-        }
+    /* check the teleporters in the order of the cells after the player, wrapping around
+     * columns and rows, until getting back to the original coordinates. */
+    size_t const count = teleporter_cells.size();
+    size_t const first = std::upper_bound(teleporter_cells.begin(), teleporter_cells.end(), py * w + px) - teleporter_cells.begin();
+    for (size_t i = 0; i < count; i++) {
+        int index = teleporter_cells[(first + i) % count];
+        int tx = index % w, ty = index / w;
         /* if we found a teleporter... */
         if (get(tx, ty) == O_TELEPORTER && is_like_space(tx, ty, player_move)) {
             store(tx, ty, player_move, get(px, py));    /* new player appears near teleporter found */
             store(px, py, O_SPACE); /* current player disappears */
             sound_play(GD_S_TELEPORTER, tx, ty);
-            teleported = true;  /* success */
+            return true;    /* success */
         }
-    } while (!teleported && (tx != px || ty != py)); /* loop until we get back to original coordinates */
-    return teleported;
+    }
+    return false;
 }
 
 /**
@@ -1596,20 +1723,54 @@ GdDirectionEnum CaveRendered::iterate(GdDirectionEnum player_move, bool player_f
         ymin = 1;
         ymax = h - 2;
     }
+    /* find the teleporters of a new map; later store() remembers them */
+    if (postprocess_whole_map) {
+        teleporter_cells.clear();
+        for (int y = 0; y < h; y++)
+            for (int x = 0; x < w; x++)
+                if (map(x, y) == O_TELEPORTER)
+                    teleporter_cells.push_back(y * w + x);
+    }
+    /* all segments of a new map must be visited */
+    int const segments_per_row = active_segments_per_row();
+    if (active_segments.size() != unsigned(segments_per_row * h))
+        active_segments.assign(segments_per_row * h, true);
+
     /* the cave scan routine */
+    unsigned char *segment_active = NULL;
     for (int y = ymin; y <= ymax; y++)
         for (int x = 0; x < w; x++) {
+            /* skip segments which have only inert elements. if the segment is visited,
+             * its flag is cleared, and set again by any cell which is not inert after
+             * processing, or by store() putting something there later. */
+            if (x % ActiveSegmentWidth == 0) {
+                segment_active = &active_segments[y * segments_per_row + x / ActiveSegmentWidth];
+                if (!*segment_active) {
+                    x += ActiveSegmentWidth - 1;
+                    continue;
+                }
+                *segment_active = false;
+            }
+
+            GdElementEnum const element = get(x, y);
+
             /* if we find a scanned element, change it to the normal one, and that's all. */
             /* this is required, for example for chasing stones, which have moved, always passing slime! */
-            if (is_scanned(x, y)) {
+            if (is_scanned_element(element)) {
                 unscan(x, y);
+                *segment_active = true;
                 continue;
             }
 
             /* add the ckdelay correction value for every element seen. */
-            ckdelay_current += gd_element_properties[get(x, y)].ckdelay;
+            ckdelay_current += gd_element_ckdelay[element];
 
-            switch (get(x, y)) {
+            /* most of the cave is dirt, brick and the like; they do nothing, and
+             * cannot become scanned by themselves, so skip the switch below. */
+            if (inert_element[element])
+                continue;
+
+            switch (element) {
                     /*
                      *  P L A Y E R S
                      */
@@ -2484,8 +2645,7 @@ GdDirectionEnum CaveRendered::iterate(GdDirectionEnum player_move, bool player_f
                             /* if no amoeba found during THIS SCAN yet, which was able to grow, check this one. */
                             if (amoeba_found_enclosed)
                                 /* if still found enclosed, check all four directions, if this one is able to grow. */
-                                if (amoeba_eats(x, y, MV_UP) || amoeba_eats(x, y, MV_DOWN)
-                                        || amoeba_eats(x, y, MV_LEFT) || amoeba_eats(x, y, MV_RIGHT)) {
+                                if (amoeba_can_grow(x, y)) {
                                     amoeba_found_enclosed = false;  /* not enclosed. this is a local (per scan) flag! */
                                     amoeba_state = GD_AM_AWAKE;
                                 }
@@ -2538,8 +2698,7 @@ GdDirectionEnum CaveRendered::iterate(GdDirectionEnum player_move, bool player_f
                             case GD_AM_AWAKE:
                                 /* if no amoeba found during THIS SCAN yet, which was able to grow, check this one. */
                                 if (amoeba_2_found_enclosed)
-                                    if (amoeba_eats(x, y, MV_UP) || amoeba_eats(x, y, MV_DOWN)
-                                            || amoeba_eats(x, y, MV_LEFT) || amoeba_eats(x, y, MV_RIGHT)) {
+                                    if (amoeba_can_grow(x, y)) {
                                         amoeba_2_found_enclosed = false; /* not enclosed. this is a local (per scan) flag! */
                                         amoeba_2_state = GD_AM_AWAKE;
                                     }
@@ -2981,6 +3140,8 @@ GdDirectionEnum CaveRendered::iterate(GdDirectionEnum player_move, bool player_f
             /* and, it must be cleared, as it should not be scanned; for example, */
             /* if it is, a replicator will not replicate it! */
             unscan(x, y);
+            if (!inert_element[get(x, y)])
+                *segment_active = true;
         }
 
     /* POSTPROCESSING */
@@ -2988,48 +3149,66 @@ GdDirectionEnum CaveRendered::iterate(GdDirectionEnum player_move, bool player_f
     /* forget "scanned" flags for objects. */
     /* also, check for time penalties. */
     /* these is something like an effect table, but we do not really use one. */
-    for (int y = 0; y < h; y++)
-        for (int x = 0; x < w; x++) {
-            unscan(x, y);
-            if (get(x, y) == O_TIME_PENALTY) {
-                store(x, y, O_GRAVESTONE);
-                time_decrement_sec += time_penalty; /* there is time penalty for destroying the voodoo */
+    /* only the cells remembered by store() can be scanned or hold a time penalty;
+     * the cells in front of the scan were already unscanned by the loop above. */
+    if (postprocess_whole_map) {
+        postprocess_cells.clear();
+        player_cells.clear();
+        for (int y = 0; y < h; y++)
+            for (int x = 0; x < w; x++) {
+                postprocess_cells.push_back(Coordinate(x, y));
+                player_cells.push_back(y * w + x);
             }
+        postprocess_whole_map = false;
+    }
+    for (size_t i = 0; i < postprocess_cells.size(); i++) {
+        int x = postprocess_cells[i].x, y = postprocess_cells[i].y;
+        unscan(x, y);
+        if (get(x, y) == O_TIME_PENALTY) {
+            store(x, y, O_GRAVESTONE);
+            time_decrement_sec += time_penalty; /* there is time penalty for destroying the voodoo */
         }
+    }
+    postprocess_cells.clear();
 
     /* another scan-like routine: */
     /* short explosions (for example, in bd1) started with explode_2. */
     /* internally we use explode_1; and change it to explode_2 if needed. */
+    /* explosions are not inert, so only the active segments have to be checked. */
     if (short_explosions)
         for (int y = 0; y < h; y++)
-            for (int x = 0; x < w; x++)
-                if (is_first_stage_of_explosion(x, y)) {
-                    next(x, y); /* select next frame of explosion */
-                    unscan(x, y); /* forget scanned flag immediately */
-                }
+            for (int x = 0; x < w; x += ActiveSegmentWidth) {
+                if (!active_segments[y * segments_per_row + x / ActiveSegmentWidth])
+                    continue;
+                for (int sx = x; sx < std::min<int>(x + ActiveSegmentWidth, w); sx++)
+                    if (is_first_stage_of_explosion(sx, y)) {
+                        next(sx, y); /* select next frame of explosion */
+                        unscan(sx, y); /* forget scanned flag immediately */
+                    }
+            }
 
-    /* this loop finds the coordinates of the player. needed for scrolling and chasing stone.*/
+    /* forget the cells which do not contain a player anymore. the remaining ones
+     * are all the players on the map: the ones remembered from the previous frame,
+     * and the ones store() put on the map since then. */
+    std::sort(player_cells.begin(), player_cells.end());
+    player_cells.erase(std::unique(player_cells.begin(), player_cells.end()), player_cells.end());
+    player_cells.erase(std::remove_if(player_cells.begin(), player_cells.end(), [this](int index) {
+        return !is_player(index % w, index / w);
+    }), player_cells.end());
+
+    /* forget the cells where a teleporter was destroyed */
+    teleporter_cells.erase(std::remove_if(teleporter_cells.begin(), teleporter_cells.end(), [this](int index) {
+        return get(index % w, index / w) != O_TELEPORTER;
+    }), teleporter_cells.end());
+
+    /* find the coordinates of the player. needed for scrolling and chasing stone.*/
     /* but we only do this, if a living player was found. otherwise "stay" at current coordinates. */
-    if (player_state == GD_PL_LIVING) {
-        if (active_is_first_found) {
-            /* to be 1stb compatible, we do everything backwards. */
-            for (int y = h - 1; y >= 0; y--)
-                for (int x = w - 1; x >= 0; x--)
-                    if (is_player(x, y)) {
-                        /* here we remember the coordinates. */
-                        player_x = x;
-                        player_y = y;
-                    }
-        } else {
-            /* as in the original: look for the last one */
-            for (int y = 0; y < h; y++)
-                for (int x = 0; x < w; x++)
-                    if (is_player(x, y)) {
-                        /* here we remember the coordinates. */
-                        player_x = x;
-                        player_y = y;
-                    }
-        }
+    /* the list is in the order of the scan, so the first found is the first one in the list. */
+    if (player_state == GD_PL_LIVING && !player_cells.empty()) {
+        /* to be 1stb compatible, take the first one. as in the original: take the last one */
+        int index = active_is_first_found ? player_cells.front() : player_cells.back();
+        player_x = index % w;
+        player_y = index / w;
     }
     /* record coordinates of player for chasing stone */
     for (unsigned i = 0; i < PlayerMemSize - 1; i++) {
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2007-2018, GDash Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "config.h"
+
+#include <glib.h>
+#include <algorithm>
+
+#include "cave/cavesnapshotring.hpp"
+#include "cave/caverendered.hpp"
+
+
+/// Create an empty ring.
+/// @param capacity The maximum number of snapshots stored.
+/// @param keyframe_interval Every keyframe_interval-th snapshot is stored in full.
+CaveSnapshotRing::CaveSnapshotRing(unsigned capacity, unsigned keyframe_interval)
+    : capacity(capacity),
+      keyframe_interval(keyframe_interval),
+      since_keyframe(0) {
+    g_assert(capacity >= 1 && keyframe_interval >= 1);
+}
+
+
+/// Forget all snapshots.
+void CaveSnapshotRing::clear() {
+    snapshots.clear();
+    newest.clear();
+    since_keyframe = 0;
+}
+
+
+/// Store the difference of two states of the same size.
+/// The difference is a list of runs: a 16-bit number of unchanged bytes to skip,
+/// a 16-bit number of changed bytes, and the changed bytes themselves.
+void CaveSnapshotRing::encode_difference(std::vector<guint8> const &from, std::vector<guint8> const &to, std::vector<guint8> &difference) {
+    g_assert(from.size() == to.size());
+    difference.clear();
+    size_t pos = 0;
+    while (pos < to.size()) {
+        size_t skip = 0;
+        while (pos + skip < to.size() && skip < G_MAXUINT16 && from[pos + skip] == to[pos + skip])
+            skip++;
+        size_t count = 0;
+        while (pos + skip + count < to.size() && count < G_MAXUINT16 && from[pos + skip + count] != to[pos + skip + count])
+            count++;
+        if (count == 0 && pos + skip == to.size())
+            break;  /* no more changes */
+        difference.push_back(skip & 0xff);
+        difference.push_back(skip >> 8);
+        difference.push_back(count & 0xff);
+        difference.push_back(count >> 8);
+        difference.insert(difference.end(), to.begin() + pos + skip, to.begin() + pos + skip + count);
+        pos += skip + count;
+    }
+}
+
+
+/// Apply a difference created by encode_difference() to a state.
+void CaveSnapshotRing::apply_difference(std::vector<guint8> &state, std::vector<guint8> const &difference) {
+    size_t pos = 0, i = 0;
+    while (i < difference.size()) {
+        g_assert(i + 4 <= difference.size());
+        size_t skip = difference[i] | difference[i + 1] << 8;
+        size_t count = difference[i + 2] | difference[i + 3] << 8;
+        i += 4;
+        pos += skip;
+        g_assert(pos + count <= state.size() && i + count <= difference.size());
+        std::copy(difference.begin() + i, difference.begin() + i + count, state.begin() + pos);
+        pos += count;
+        i += count;
+    }
+}
+
+
+/// Reconstruct the full state of a snapshot, starting from the nearest keyframe before it.
+std::vector<guint8> CaveSnapshotRing::decode(unsigned index) const {
+    g_assert(index < snapshots.size());
+    unsigned key = index;
+    while (!snapshots[key].keyframe)
+        key--;      /* the first snapshot is always a keyframe, so this stops */
+    std::vector<guint8> state = snapshots[key].data;
+    for (unsigned i = key + 1; i <= index; ++i)
+        apply_difference(state, snapshots[i].data);
+    return state;
+}
+
+
+/// Reconstruct the random number generator of a snapshot, from the one of the nearest keyframe before it.
+RandomGenerator CaveSnapshotRing::decode_random(unsigned index) const {
+    g_assert(index < snapshots.size());
+    unsigned key = index;
+    while (!snapshots[key].keyframe)
+        key--;
+    RandomGenerator random(*snapshots[key].random);
+    g_assert(snapshots[index].random_draws >= random.get_draws());
+    random.skip(snapshots[index].random_draws - random.get_draws());
+    return random;
+}
+
+
+/// Take a snapshot of the cave, and store it as the newest one.
+/// If the ring is full, the oldest snapshot is dropped.
+/// @param cave The cave; should always be the same cave between calls of clear().
+/// @param frame A frame number to remember, for example the number of iterations.
+/// @param score A score value to remember.
+void CaveSnapshotRing::push(CaveRendered const &cave, int frame, int score) {
+    std::vector<guint8> state;
+    cave.save_state(state);
+
+    /* a new keyframe is needed for the first snapshot, regularly, or if the state has a different size (should not happen) */
+    if (snapshots.empty() || since_keyframe + 1 >= keyframe_interval || state.size() != newest.size()) {
+        snapshots.push_back(Snapshot{frame, score, true, state, cave.random.get_draws(), std::make_unique<RandomGenerator>(cave.random)});
+        since_keyframe = 0;
+    } else {
+        std::vector<guint8> difference;
+        encode_difference(newest, state, difference);
+        snapshots.push_back(Snapshot{frame, score, false, std::move(difference), cave.random.get_draws(), NULL});
+        since_keyframe++;
+    }
+    newest = std::move(state);
+
+    if (snapshots.size() > capacity) {
+        /* the second one becomes the first; it must be a keyframe */
+        if (!snapshots[1].keyframe) {
+            snapshots[1].data = decode(1);
+            snapshots[1].random = std::make_unique<RandomGenerator>(decode_random(1));
+            snapshots[1].keyframe = true;
+        }
+        snapshots.pop_front();
+    }
+}
+
+
+/// Restore the state of the cave from a snapshot.
+/// @param index The index of the snapshot, 0 is the oldest one.
+/// @param cave The cave to restore; must be the one the snapshots were taken of.
+void CaveSnapshotRing::restore(unsigned index, CaveRendered &cave) const {
+    cave.load_state(decode(index));
+    cave.random = decode_random(index);
+}
+
+
+/// Forget the newest snapshots, so only the given number of them remains.
+/// This is to be called when the game continues from an earlier snapshot;
+/// the later ones are of a different timeline.
+void CaveSnapshotRing::truncate(unsigned size) {
+    if (size >= snapshots.size())
+        return;
+    snapshots.erase(snapshots.begin() + size, snapshots.end());
+    if (snapshots.empty()) {
+        clear();
+        return;
+    }
+    newest = decode(size - 1);
+    since_keyframe = 0;
+    for (unsigned i = size - 1; !snapshots[i].keyframe; --i)
+        since_keyframe++;
+}
+
+
+/// Find the newest snapshot taken at the given frame or before it.
+/// @return The index of the snapshot, or -1 if there is no such snapshot.
+int CaveSnapshotRing::find(int frame) const {
+    /* frame numbers are increasing, so do a binary search */
+    int first = 0, last = int(snapshots.size()) - 1, found = -1;
+    while (first <= last) {
+        int middle = (first + last) / 2;
+        if (snapshots[middle].frame <= frame) {
+            found = middle;
+            first = middle + 1;
+        } else
+            last = middle - 1;
+    }
+    return found;
+}
+
+
+/// The number of bytes used by the stored states, differences and random number generators.
+size_t CaveSnapshotRing::memory_used() const {
+    size_t bytes = newest.size();
+    for (auto const &snapshot : snapshots) {
+        bytes += sizeof(Snapshot) + snapshot.data.size();
+        if (snapshot.random)
+            bytes += RandomGenerator::memory_size;
+    }
+    return bytes;
+}
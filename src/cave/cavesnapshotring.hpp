@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2007-2018, GDash Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef CAVESNAPSHOTRING_HPP_INCLUDED
+#define CAVESNAPSHOTRING_HPP_INCLUDED
+
+#include "config.h"
+
+#include <glib.h>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "cave/helper/caverandom.hpp"
+
+class CaveRendered;
+
+/// @ingroup Cave
+/**
+ * A ring buffer of snapshots taken of a cave during the game, to be able to rewind it.
+ *
+ * Snapshots store the state of the cave as given by CaveRendered::save_state().
+ * Most snapshots only store the difference to the previous one, which is small,
+ * as only a few cells of the cave change between two snapshots. Every
+ * keyframe_interval-th snapshot is stored in full, so restoring one never has
+ * to apply too many differences. The random number generator of the cave is
+ * only copied for the keyframes; for the other snapshots, it is brought forward
+ * from the keyframe by the number of random numbers generated since.
+ * If the ring is full, the oldest snapshot is forgotten.
+ */
+class CaveSnapshotRing {
+public:
+    explicit CaveSnapshotRing(unsigned capacity = 600, unsigned keyframe_interval = 32);
+
+    void clear();
+    void push(CaveRendered const &cave, int frame, int score);
+    void restore(unsigned index, CaveRendered &cave) const;
+    void truncate(unsigned size);
+    int find(int frame) const;
+
+    /// The number of snapshots stored.
+    unsigned size() const {
+        return snapshots.size();
+    }
+    /// True if no snapshot is stored.
+    bool empty() const {
+        return snapshots.empty();
+    }
+    /// The frame number given when the snapshot was taken.
+    int frame(unsigned index) const {
+        return snapshots[index].frame;
+    }
+    /// The score given when the snapshot was taken.
+    int score(unsigned index) const {
+        return snapshots[index].score;
+    }
+    size_t memory_used() const;
+
+private:
+    /// One stored snapshot.
+    struct Snapshot {
+        int frame;                  ///< frame number given by the caller, usually the number of iterations
+        int score;                  ///< score given by the caller; the cave does not know the score of the player
+        bool keyframe;              ///< if true, data is the state itself; otherwise the difference to the previous snapshot
+        std::vector<guint8> data;   ///< the state, or the difference
+        guint64 random_draws;       ///< RandomGenerator::get_draws() of the cave
+        std::unique_ptr<RandomGenerator> random;    ///< copy of the random number generator of the cave, only for keyframes
+    };
+
+    unsigned capacity;
+    unsigned keyframe_interval;
+    std::deque<Snapshot> snapshots;
+    std::vector<guint8> newest;     ///< the state of the newest snapshot, to calculate the difference from
+    unsigned since_keyframe;        ///< number of difference snapshots after the newest keyframe
+
+    std::vector<guint8> decode(unsigned index) const;
+    RandomGenerator decode_random(unsigned index) const;
+    static void encode_difference(std::vector<guint8> const &from, std::vector<guint8> const &to, std::vector<guint8> &difference);
+    static void apply_difference(std::vector<guint8> &state, std::vector<guint8> const &difference);
+};
+
+#endif
@@ -275,6 +275,8 @@ void CharToElementTable::set(unsigned i, GdElementEnum e) {
 static NameValuePair<GdElementEnum> name_to_element;
 
 void gd_cave_types_init() {
+    gd_element_properties_init();
+
     /* put names to a hash table */
     /* this is a helper for file read operations */
 
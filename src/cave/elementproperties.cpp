@@ -903,6 +903,25 @@ GdElementPorperty gd_element_properties[] = {
     {O_MAX_INDEX},
 };
 
+guint32 gd_element_flags[O_MAX_INDEX];
+guint16 gd_element_pair[O_MAX_INDEX];
+guint16 gd_element_ckdelay[O_MAX_INDEX];
+gint16 gd_element_image_game[O_MAX_INDEX];
+
+/// Fill the compact per-element arrays from gd_element_properties.
+void gd_element_properties_init() {
+    for (int i = 0; i < O_MAX_INDEX; i++) {
+        g_assert(gd_element_properties[i].element == i);
+        g_assert(gd_element_properties[i].ckdelay >= 0 && gd_element_properties[i].ckdelay <= G_MAXUINT16);
+        g_assert(gd_element_properties[i].image_game >= G_MININT16 && gd_element_properties[i].image_game <= G_MAXINT16);
+        gd_element_flags[i] = gd_element_properties[i].flags;
+        gd_element_pair[i] = gd_element_properties[i].pair;
+        gd_element_ckdelay[i] = gd_element_properties[i].ckdelay;
+        gd_element_image_game[i] = gd_element_properties[i].image_game;
+    }
+}
+
+
 /* return new element, which appears after elem is hammered. */
 /* returns o_none, if elem is invalid for hammering. */
 GdElementEnum
@@ -26,6 +26,8 @@
 
 #include "config.h"
 
+#include <glib.h>
+
 #include "cavetypes.hpp"
 
 /// This enum lists some properties of elements, which are used by the engine.
@@ -109,26 +111,39 @@ struct GdElementPorperty {
 
 extern GdElementPorperty gd_element_properties[];
 
+/// Copies of the fields of gd_element_properties which are read in the
+/// inner loops of the engine and of the cave drawing, indexed by element.
+/// A GdElementPorperty takes a whole cache line; these arrays hold the same
+/// information for every element in a few of them. Filled by
+/// gd_element_properties_init(); the editor and the file operations still
+/// use the full table.
+extern guint32 gd_element_flags[O_MAX_INDEX];
+extern guint16 gd_element_pair[O_MAX_INDEX];
+extern guint16 gd_element_ckdelay[O_MAX_INDEX];     ///< 16 bits, as some ckdelay values are above 255
+extern gint16 gd_element_image_game[O_MAX_INDEX];
+
+void gd_element_properties_init();
+
 
 /// returns true, if the given element is scanned
 inline bool is_scanned_element(GdElementEnum e) {
-    return (gd_element_properties[e].flags & P_SCANNED) != 0;
+    return (gd_element_flags[e] & P_SCANNED) != 0;
 }
 
 
 /// This function converts an element to its scanned pair.
 inline GdElementEnum scanned_pair(GdElementEnum of_what) {
-    if (gd_element_properties[of_what].flags & P_SCANNED) // already scanned?
+    if (gd_element_flags[of_what] & P_SCANNED) // already scanned?
         return of_what;
-    return gd_element_properties[of_what].pair;
+    return GdElementEnum(gd_element_pair[of_what]);
 }
 
 
 /// This function converts an element to its scanned pair.
 inline GdElementEnum nonscanned_pair(GdElementEnum of_what) {
-    if (!(gd_element_properties[of_what].flags & P_SCANNED)) // already nonscanned?
+    if (!(gd_element_flags[of_what] & P_SCANNED)) // already nonscanned?
         return of_what;
-    return gd_element_properties[of_what].pair;
+    return GdElementEnum(gd_element_pair[of_what]);
 }
 
 
@@ -24,6 +24,7 @@
 
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <algorithm>
 
 #include "cave/gamecontrol.hpp"
 #include "cave/cavestored.hpp"
@@ -74,10 +75,14 @@ GameControl::GameControl(Type type) :
     statusbarsince(0),
     story_shown(false),
     caveset_has_levels(false),
+    replay_speed(1),
+    rewound(false),
+    replay_from(NULL),
     cave_num(0),
     level_num(0),
     milliseconds_game(0),
-    state_counter(GAME_INT_LOAD_CAVE) {
+    state_counter(GAME_INT_LOAD_CAVE),
+    frames_iterated(0) {
 }
 
 /// Create a full game from the caveset.
@@ -136,14 +141,15 @@ std::unique_ptr<GameControl> GameControl::new_replay(CaveSet *caveset, CaveStore
 void GameControl::add_bonus_life(bool inform_user) {
     /* only inform about bonus life when playing a game */
     /* or when testing the cave (so the user can see that a bonus life can be earned in that cave */
-    if (type == TYPE_NORMAL || type == TYPE_TEST)
+    if ((type == TYPE_NORMAL && !rewound) || type == TYPE_TEST)
         if (inform_user) {
             gd_sound_play_bonus_life();
             bonus_life_flash = 4000;
         }
 
     /* really increment number of lifes? only in a real game, nowhere else. */
-    if (type == TYPE_NORMAL && player_lives < caveset->maximum_lives)
+    /* after rewinding, the same score could be collected again and again. */
+    if (type == TYPE_NORMAL && !rewound && player_lives < caveset->maximum_lives)
         /* only add a life, if lives is >0.  lives==0 is a test run or a snapshot, no bonus life then. */
         /* also, obey max number of bonus lives. */
         player_lives++;
@@ -235,6 +241,15 @@ void GameControl::load_cave() {
 
     milliseconds_game = 0;      /* set game timer to zero, too */
     state_counter = GAME_INT_SHOW_STORY;
+
+    /* the first snapshot for rewinding is the start of the cave.
+     * for replays, keep snapshots for the whole replay, so seeking backwards is always fast. */
+    if (type == TYPE_REPLAY)
+        rewind_snapshots = CaveSnapshotRing(replay_from->length() / RewindSnapshotInterval + 16);
+    else
+        rewind_snapshots.clear();
+    frames_iterated = 0;
+    rewind_snapshots.push(*played_cave, frames_iterated, cave_score);
 }
 
 
@@ -266,6 +281,137 @@ bool GameControl::load_snapshot() {
 }
 
 
+/// Go back to the previous snapshot taken of the played cave.
+/// Can be called repeatedly, to step back further and further. The game continues
+/// from the snapshot when the cave is iterated again; before that, forward() can
+/// go to the later snapshots.
+/// When playing a replay, this jumps back by replay_seek_step() frames instead.
+/// @return true, if successful
+bool GameControl::rewind() {
+    if (state_counter != GAME_INT_CAVE_RUNNING || played_cave.get() == NULL)
+        return false;
+    if (type == TYPE_REPLAY)
+        return frames_iterated > 0 && seek(std::max(frames_iterated - replay_seek_step(), 0));
+
+    int index = rewind_snapshots.find(frames_iterated - 1);    /* the newest one before the current frame */
+    if (index < 0)
+        return false;
+    /* rewinding can undo deaths and give the same points again, so the game does not count anymore */
+    rewound = true;
+    go_to_rewind_snapshot(index);
+    return true;
+}
+
+
+/// After rewind(), go to the next snapshot.
+/// When playing a replay, this jumps forward by replay_seek_step() frames instead.
+/// @return true, if successful
+bool GameControl::forward() {
+    if (state_counter != GAME_INT_CAVE_RUNNING || played_cave.get() == NULL)
+        return false;
+    if (type == TYPE_REPLAY)
+        return seek(frames_iterated + replay_seek_step());
+
+    /* snapshots after the current frame only exist if the game was rewound */
+    unsigned index = rewind_snapshots.find(frames_iterated) + 1;
+    if (index >= rewind_snapshots.size())
+        return false;
+    go_to_rewind_snapshot(index);
+    return true;
+}
+
+
+/// Restore the played cave from a rewind snapshot, and set the score
+/// and the position of the replay accordingly.
+void GameControl::go_to_rewind_snapshot(unsigned index) {
+    rewind_snapshots.restore(index, *played_cave);
+    /* bonus lives already given are not taken away */
+    int score_change = rewind_snapshots.score(index) - cave_score;
+    player_score += score_change;
+    cave_score += score_change;
+    if (replay_record.get())
+        replay_record->score += score_change;
+
+    frames_iterated = rewind_snapshots.frame(index);
+    /* replays give one movement for every iteration */
+    if (type == TYPE_REPLAY) {
+        replay_from->seek(frames_iterated);
+        replay_no_more_movements = std::max<int>(0, frames_iterated - replay_from->length());
+    }
+    milliseconds_game = 0;
+}
+
+
+/// Jump to the given frame of the replay being played.
+/// The cave is restored from the newest snapshot before that frame, and iterated from
+/// there without drawing and sound. Snapshots are taken during this as usual, so jumping
+/// back later is always fast, and jumping forward is only slow to frames not yet seen.
+/// If the replay ends before the given frame, it stops there.
+/// @param frame The number of iterations from the start of the cave.
+/// @return true, if successful
+bool GameControl::seek(int frame) {
+    if (type != TYPE_REPLAY || state_counter != GAME_INT_CAVE_RUNNING || played_cave.get() == NULL)
+        return false;
+
+    frame = std::max(frame, 0);
+    int index = rewind_snapshots.find(frame);
+    /* restore a snapshot if going backwards, or if it is nearer to the frame than the current state */
+    if (index >= 0 && (frame < frames_iterated || rewind_snapshots.frame(index) > frames_iterated))
+        go_to_rewind_snapshot(index);
+
+    while (frames_iterated < frame && state_counter == GAME_INT_CAVE_RUNNING
+            && played_cave->player_state != GD_PL_EXITED && played_cave->player_state != GD_PL_TIMEOUT) {
+        GdDirectionEnum player_move = MV_STILL;
+        bool fire = false, suicide = false;
+        iterate_played_cave(player_move, fire, suicide);
+        /* this would end the replay; see iterate_cave() */
+        if (played_cave->player_state == GD_PL_DIED && fire)
+            state_counter = GAME_INT_COVER_START;
+    }
+    played_cave->clear_sounds();
+    if (played_cave->hatched)
+        set_status_bar_state(status_bar_game);
+    milliseconds_game = 0;
+    return true;
+}
+
+
+/// The number of frames rewind() and forward() jump when playing a replay:
+/// one twentieth of the replay, so the replay is like a slider with 20 notches.
+int GameControl::replay_seek_step() const {
+    if (replay_from == NULL)
+        return RewindSnapshotInterval;
+    return std::max<int>(RewindSnapshotInterval, replay_from->length() / 20);
+}
+
+
+/// The number of movements in the replay being played, or 0 if this is not a replay.
+int GameControl::replay_length() const {
+    if (type != TYPE_REPLAY || replay_from == NULL)
+        return 0;
+    return replay_from->length();
+}
+
+
+/// Select the next replay speed: 1x, 2x, 4x, 16x, and then 1x again.
+void GameControl::next_replay_speed() {
+    switch (replay_speed) {
+        case 1:
+            replay_speed = 2;
+            break;
+        case 2:
+            replay_speed = 4;
+            break;
+        case 4:
+            replay_speed = 16;
+            break;
+        default:
+            replay_speed = 1;
+            break;
+    }
+}
+
+
 bool GameControl::is_uncovering() const {
     return state_counter > GAME_INT_START_UNCOVER && state_counter < GAME_INT_UNCOVER_ALL;
 }
@@ -370,6 +516,51 @@ void GameControl::cover_animation() {
 }
 
 
+/// Iterate the played cave once.
+/// When playing a replay, the movements are taken from the replay; when recording one, they are stored.
+/// Also adds the score, and takes the snapshots for rewinding.
+/// @param player_move The direction of move; overwritten when playing a replay.
+/// @param fire If the user pressed the fire; overwritten when playing a replay.
+/// @param suicide If the user pressed the suicide button; overwritten when playing a replay.
+void GameControl::iterate_played_cave(GdDirectionEnum &player_move, bool &fire, bool &suicide) {
+    /* if the game was rewound, it continues from there. the later snapshots and the
+     * recorded movements are of a different timeline, so forget them. a replay
+     * always has the same timeline. */
+    if (type != TYPE_REPLAY) {
+        rewind_snapshots.truncate(rewind_snapshots.find(frames_iterated) + 1);
+        if (replay_record.get() != NULL)
+            replay_record->truncate(frames_iterated);
+    }
+
+    /* IF PLAYING FROM REPLAY, OVERWRITE KEYPRESS VARIABLES FROM REPLAY */
+    if (type == TYPE_REPLAY) {
+        /* if the user does touch the keyboard, we immediately exit replay, and he can continue playing */
+        bool result = replay_from->get_next_movement(player_move, fire, suicide);
+        /* if could not get move from snapshot, continue from keyboard input. */
+        if (!result)
+            replay_no_more_movements++;
+        /* if no more available movements, and the user does not do anything, we cover cave and stop game. */
+        if (replay_no_more_movements > 15)
+            state_counter = GAME_INT_COVER_START;
+    }
+
+    // if recording the replay, now store the movement
+    if (replay_record.get() != NULL)
+        replay_record->store_movement(player_move, fire, suicide);
+
+    /* cave iterate gives us a new player move, which might have diagonal movements removed */
+    played_cave->iterate(player_move, fire, suicide);
+    if (played_cave->score)
+        increment_score(played_cave->score);
+
+    frames_iterated++;
+    /* after seeking back in a replay, the later snapshots are still there */
+    if (frames_iterated % RewindSnapshotInterval == 0
+            && (rewind_snapshots.empty() || rewind_snapshots.frame(rewind_snapshots.size() - 1) < frames_iterated))
+        rewind_snapshots.push(*played_cave, frames_iterated, cave_score);
+}
+
+
 /// Iterate the cave.
 /// @param fast_forward If set to true, cave will be iterated at 25fps, regardless of cave speed calculated by the cave.
 /// @param player_move The direction of move, by keypresses.
@@ -406,33 +597,21 @@ GameControl::State GameControl::iterate_cave(GameInputHandler *inputhandler) {
     /* ANYTHING EXCEPT A TIMEOUT, WE ITERATE THE CAVE */
     /* iterate cave */
     return_state = STATE_NOTHING; /* normally nothing happes. but if we iterate, this might change. */
-    milliseconds_game += 40;
+    GdDirectionEnum const keyboard_move = player_move;
+    bool const keyboard_fire = fire, keyboard_suicide = suicide;
+    /* faster replays are iterated more times during the same 40ms */
+    int speed_multiplier = type == TYPE_REPLAY ? replay_speed : 1;
+    milliseconds_game += 40 * speed_multiplier;
 
     /* decide if cave will be iterated. */
-    if (played_cave->player_state != GD_PL_TIMEOUT && milliseconds_game >= irl_cavespeed) {
+    for (int i = 0; i < speed_multiplier && played_cave->player_state != GD_PL_TIMEOUT && milliseconds_game >= irl_cavespeed; ++i) {
         // ok, cave has to be iterated.
-
-        /* IF PLAYING FROM REPLAY, OVERWRITE KEYPRESS VARIABLES FROM REPLAY */
-        if (type == TYPE_REPLAY) {
-            /* if the user does touch the keyboard, we immediately exit replay, and he can continue playing */
-            bool result = replay_from->get_next_movement(player_move, fire, suicide);
-            /* if could not get move from snapshot, continue from keyboard input. */
-            if (!result)
-                replay_no_more_movements++;
-            /* if no more available movements, and the user does not do anything, we cover cave and stop game. */
-            if (replay_no_more_movements > 15)
-                state_counter = GAME_INT_COVER_START;
-        }
-
         milliseconds_game -= irl_cavespeed;
-        // if recording the replay, now store the movement
-        if (replay_record.get() != NULL)
-            replay_record->store_movement(player_move, fire, suicide);
-
-        /* cave iterate gives us a new player move, which might have diagonal movements removed */
-        played_cave->iterate(player_move, fire, suicide);
-        if (played_cave->score)
-            increment_score(played_cave->score);
+        /* every iteration starts from the keypresses; a replay might overwrite them */
+        player_move = keyboard_move;
+        fire = keyboard_fire;
+        suicide = keyboard_suicide;
+        iterate_played_cave(player_move, fire, suicide);
         return_state = STATE_NOTHING;
         /* as we iterated, the score and the like could have been changed.
          * but only do this if the player is not hatched yet (ie only after cave start signal) */
@@ -440,11 +619,16 @@ GameControl::State GameControl::iterate_cave(GameInputHandler *inputhandler) {
             set_status_bar_state(status_bar_game);
 
         gd_sound_play_sounds(played_cave->sound1, played_cave->sound2, played_cave->sound3);
+
+        /* stop here if the replay or the cave ended, or the player died and fire is pressed; handled below */
+        if (state_counter != GAME_INT_CAVE_RUNNING || played_cave->player_state == GD_PL_EXITED
+                || (played_cave->player_state == GD_PL_DIED && fire))
+            break;
     }
 
     if (played_cave->player_state == GD_PL_EXITED) {
         // if recording the replay, now store the movement
-        if (replay_record.get() != NULL)
+        if (replay_record.get() != NULL && !rewound)
             replay_record->success = true;
         /* start adding points for remaining time */
         state_counter = GAME_INT_CHECK_BONUS_TIME;
@@ -548,7 +732,8 @@ void GameControl::unload_cave() {
             if (played_cave->intermission && played_cave->intermission_rewardlife)
                 add_bonus_life(false);
             // we also have added points for remaining time -> now check for highscore
-            original_cave->highscore.add(player_name, cave_score);
+            if (!rewound)
+                original_cave->highscore.add(player_name, cave_score);
         }
 
         /* put into game statistics */
@@ -558,9 +743,9 @@ void GameControl::unload_cave() {
         }
         if (played_cave->diamonds_collected > original_cave->stat_level_most_diamonds[level_num])
             original_cave->stat_level_most_diamonds[level_num] = played_cave->diamonds_collected;
-        if (cave_score > original_cave->stat_level_highest_score[level_num])
+        if (cave_score > original_cave->stat_level_highest_score[level_num] && !rewound)
             original_cave->stat_level_highest_score[level_num] = cave_score;
-        if (played_cave->player_state == GD_PL_EXITED) {
+        if (played_cave->player_state == GD_PL_EXITED && !rewound) {
             /* use timing in seconds, but use cave seconds (maybe pal seconds = 1200ms) */
             /* only record time, if it was successfull (otherwise we would record 1sec deaths :D) */
             int time = played_cave->time_elapsed / played_cave->timing_factor;
@@ -30,6 +30,7 @@
 #include "cave/cavetypes.hpp"
 #include "cave/caverendered.hpp"
 #include "cave/helper/cavereplay.hpp"
+#include "cave/cavesnapshotring.hpp"
 
 // forward declarations
 class CaveSet;
@@ -135,6 +136,15 @@ public:
     /* functions to work on */
     bool save_snapshot() const;
     bool load_snapshot();
+    bool rewind();
+    bool forward();
+    bool seek(int frame);
+    void next_replay_speed();
+    int replay_length() const;
+    /// The number of iterations of the played cave since its start.
+    int get_frame() const {
+        return frames_iterated;
+    }
     State main_int(GameInputHandler *inputhandler, bool allow_iterate);
     bool is_uncovering() const;
 
@@ -159,6 +169,8 @@ public:
     int replay_no_more_movements;
     bool story_shown;           ///< variable to remember if the story for a particular cave is to be shown.
     bool caveset_has_levels;    ///< set to true in the constructor if the caveset has difficulty levels
+    int replay_speed;           ///< replays are played this many times faster than the cave speed; 1, 2, 4 or 16
+    bool rewound;               ///< set when the player rewinds a cave; from then on, the game earns no bonus lives and no highscores
 
 private:
     std::unique_ptr<CaveReplay> replay_record;
@@ -171,9 +183,16 @@ private:
     
     static std::unique_ptr<CaveRendered> snapshot_cave;   ///< Saved snapshot
 
+    enum { RewindSnapshotInterval = 5 };    ///< a snapshot for rewinding is taken after every this many iterations
+    CaveSnapshotRing rewind_snapshots;      ///< snapshots of the played cave, to rewind it
+    int frames_iterated;                    ///< number of iterations of the played cave
+
     void add_bonus_life(bool inform_user);
     void increment_score(int increment);
     void select_next_level_indexes();
+    void go_to_rewind_snapshot(unsigned index);
+    int replay_seek_step() const;
+    void iterate_played_cave(GdDirectionEnum &player_move, bool &fire, bool &suicide);
 
     void set_status_bar_state(StatusBarState s);
 
@@ -27,6 +27,7 @@
 #include <cassert>
 #include <cmath>
 #include <numeric>
+#include <algorithm>
 
 #include "cave/gamerender.hpp"
 
@@ -69,6 +70,7 @@ GameRenderer::GameRenderer(Screen &screen, CellRenderer &cells, FontManager &fon
         millisecs_game(0),
         animcycle(0),
         must_draw_cave(false), must_clear_screen(false), must_draw_status(false), must_draw_story(false),
+        cave_layer_x(0), cave_layer_y(0),
         status_bar_fast(false),
         status_bar_alternate(false),
         status_bar_paused(false) {
@@ -77,6 +79,7 @@ GameRenderer::GameRenderer(Screen &screen, CellRenderer &cells, FontManager &fon
 
 void GameRenderer::release_pixmaps() {
     story.background.release();
+    cave_layer.reset();
 }
 
 
@@ -315,43 +318,76 @@ void GameRenderer::drawcave() const {
     if (cave_smaller_than_view)
         yplus = 0; // align top
 
+    /* particles drawn into the screen surface must be erased by drawing the cells again in the next frame */
+    bool particles_on_surface = gd_particle_effects && screen.draws_particles_on_surface();
+
     /* if using particle effects, draw the background, as particles might have moved "out" of it.
      * we should only do this if the cave is smaller than the screen! that we well know from the xplus
      * and yplus variables set above. */
-    if (must_clear_screen || (gd_particle_effects && (xplus != 0 || yplus != 0))) {
+    if (must_clear_screen || (particles_on_surface && (xplus != 0 || yplus != 0))) {
         /* fill screen with status bar background color - particle effects might have gone "out" of the cave */
         screen.fill(cols.background);
     }
 
+    /* on-screen coordinates of the upper left visible cell */
+    int cave_x = floor(xplus - scroll_x);
+    int cave_y = yplus - scroll_y_aligned + statusbar_height;
+
+    /* get the layer, if the screen can create one, and it is not too big */
+    int const layer_max_pixels = 4096 * 4096;
+    if (cave_pixel_w * cave_pixel_h <= layer_max_pixels) {
+        if (!cave_layer || cave_layer->get_width() != cave_pixel_w || cave_layer->get_height() != cave_pixel_h) {
+            cave_layer = screen.create_layer(cave_pixel_w, cave_pixel_h);
+            cave_layer_cells.assign((visible_w + 1) * (visible_h + 1), -1);
+        }
+    } else
+        cave_layer.reset();
+    /* if the screen is cleared, it might be because the cells changed, so draw the layer again */
+    if (cave_layer && must_clear_screen)
+        std::fill(cave_layer_cells.begin(), cave_layer_cells.end(), -1);
+    /* if the cave scrolled, or particles must be erased, the whole layer is copied to the screen.
+     * otherwise only the changed cells are drawn. */
+    bool compose_layer = cave_layer && (must_clear_screen || particles_on_surface || cave_x != cave_layer_x || cave_y != cave_layer_y);
+
     /* here we draw all cells to be redrawn. the in-cell clipping will be done by the graphics
      * engine, we only clip full cells. */
     /* the x and y coordinates are cave physical coordinates.
      * xd and yd are relative to the visible area. */
     int x, y, xd, yd;
     for (y = game.played_cave->y1, yd = 0; y <= game.played_cave->y2; y++, yd++) {
-        int ys = yplus - scroll_y_aligned + statusbar_height + yd * cell_size;
+        int ys = cave_y + yd * cell_size;
         for (x = game.played_cave->x1, xd = 0; x <= game.played_cave->x2; x++, xd++) {
-            if (game.gfx_buffer(x, y) & GD_REDRAW) {    /* if it needs to be redrawn */
+            int dr = game.gfx_buffer(x, y) & ~GD_REDRAW;
+            if (cave_layer) {
+                int &in_layer = cave_layer_cells[yd * (visible_w + 1) + xd];
+                if (in_layer != dr) {
+                    screen.blit_to_layer(*cave_layer, cells.cell(dr), xd * cell_size, yd * cell_size);
+                    in_layer = dr;
+                }
+            }
+            if ((game.gfx_buffer(x, y) & GD_REDRAW) && !compose_layer) {    /* if it needs to be redrawn */
                 // calculate on-screen coordinates
-                int xs = xplus - scroll_x + xd * cell_size;
-                int dr = game.gfx_buffer(x, y) & ~GD_REDRAW;
+                int xs = cave_x + xd * cell_size;
                 screen.blit(cells.cell(dr), xs, ys);
-                game.gfx_buffer(x, y) = dr;   /* now that we drew it */
             }
+            game.gfx_buffer(x, y) = dr;   /* now that we drew it */
         }
     }
+    if (compose_layer) {
+        screen.blit(*cave_layer, cave_x, cave_y);
+        cave_layer_x = cave_x;
+        cave_layer_y = cave_y;
+    }
 
     /* now draw the particles */
     if (gd_particle_effects) {
         int xs = xplus - scroll_x - game.played_cave->x1 * cell_size;
         int ys = yplus + statusbar_height - scroll_y_aligned - game.played_cave->y1 * cell_size;
-        std::list<ParticleSet>::const_iterator it;
-        for (it = game.played_cave->particles.begin(); it != game.played_cave->particles.end(); ++it)
-            screen.draw_particle_set(xs, ys, *it);
+        screen.draw_particles(xs, ys, game.played_cave->particles);
     }
 
-    /* if using particle effects, the whole cave needs to be redrawn later. */
-    if (gd_particle_effects) {
+    /* if the particles were drawn into the surface, the whole cave needs to be redrawn later. */
+    if (particles_on_surface) {
         /* remember to redraw the whole cave */
         for (int y = game.played_cave->y1; y <= game.played_cave->y2; y++)
             for (int x = game.played_cave->x1; x <= game.played_cave->x2; x++)
@@ -386,8 +422,18 @@ bool GameRenderer::drawstatus_firstline(bool in_game) const {
     switch (game.type) {
         case GameControl::TYPE_REPLAY:
             if (show_replay_sign) {
-                // TRANSLATORS: the translated string must be at most 20 characters long
-                font_manager.blittext(-1, statusbar_y1, GD_GDASH_YELLOW, _("PLAYING REPLAY"));
+                if (game.replay_speed == 1)
+                    // TRANSLATORS: the translated string must be at most 20 characters long
+                    font_manager.blittext(-1, statusbar_y1, GD_GDASH_YELLOW, _("PLAYING REPLAY"));
+                else
+                    // TRANSLATORS: the translated string must be at most 20 characters long. %d is the speed, like 4.
+                    font_manager.blittext(-1, statusbar_y1, GD_GDASH_YELLOW, _("REPLAY %dX"), game.replay_speed);
+                /* position in the replay, as a slider at the bottom of the status bar */
+                if (in_game && game.replay_length() > 0) {
+                    int scale = screen.get_pixmap_scale();
+                    int position = std::min(game.get_frame(), game.replay_length());
+                    screen.fill_rect(0, statusbar_height - scale, screen.get_width() * position / game.replay_length(), scale, GD_GDASH_YELLOW);
+                }
                 first_line = true;
             } else if (gd_show_name_of_game && !in_game) {
                 /* if showing the name of the cave... */
@@ -656,8 +702,12 @@ void GameRenderer::select_status_bar_colors() {
 
 
 void GameRenderer::set_colors_from_cave() {
+    /* the cells will change, so the layer must be drawn again */
+    cave_layer.reset();
     /* select colors, prepare drawing etc. */
     cells.select_pixbuf_colors(game.played_cave->color0, game.played_cave->color1, game.played_cave->color2, game.played_cave->color3, game.played_cave->color4, game.played_cave->color5);
+    /* scale the cells in the background, while the cave is uncovered */
+    cells.prepare_cells();
     /* select status bar colors here, as some depend on actual cave colors */
     select_status_bar_colors();
 
@@ -755,12 +805,6 @@ void GameRenderer::screen_initialized() {
     story.linesavailable = screen.get_height() / font_manager.get_line_height() - 6;
 }
 
-/** For removing old particles (a predicate) */
-static bool old_particle(ParticleSet const &ps) {
-    return ps.life < 0;
-}
-
-
 GameRenderer::State GameRenderer::main_int(int millisecs_elapsed, bool paused, GameInputHandler *inputhandler) {
     GameControl::State state = GameControl::STATE_NOTHING;
 
@@ -832,13 +876,8 @@ GameRenderer::State GameRenderer::main_int(int millisecs_elapsed, bool paused, G
         out_of_window = scroll(millisecs_elapsed, game.played_cave->player_state == GD_PL_NOT_YET);
 
         /* move the particles */
-        std::list<ParticleSet>::iterator it;
-        for (it = game.played_cave->particles.begin(); it != game.played_cave->particles.end(); ++it) {
-            if (it->is_new)
-                it->normalize(cells.get_cell_size());
-            it->move(millisecs_elapsed);
-        }
-        game.played_cave->particles.remove_if(old_particle);
+        game.played_cave->particles.normalize(cells.get_cell_size());
+        game.played_cave->particles.move(millisecs_elapsed);
 
         /* always render the cave to the gfx buffer; however it may do nothing if animcycle was not changed. */
         game.played_cave->draw_indexes(game.gfx_buffer, game.covered, game.bonus_life_flash > 0, animcycle, gd_no_invisible_outbox);
@@ -101,6 +101,13 @@ class GameRenderer : public PixmapStorage {
 
     mutable bool must_draw_cave, must_clear_screen, must_draw_status, must_draw_story;
 
+    /// The visible part of the cave drawn into an offscreen layer, if the screen supports it.
+    /// When scrolling, the layer is copied to the screen with a single blit, instead
+    /// of blitting all the cells again; cells are only drawn to the layer if they change.
+    mutable std::unique_ptr<Pixmap> cave_layer;
+    mutable std::vector<int> cave_layer_cells;  ///< The cell index drawn to the layer for every cave cell; -1 if none.
+    mutable int cave_layer_x, cave_layer_y;     ///< The position of the layer on the screen in the last frame.
+
     // the last set status bar in the game
     bool status_bar_fast, status_bar_alternate, status_bar_paused;
 
@@ -118,26 +118,47 @@ public:
     }
     
     T & operator()(int x, int y) {
-        switch (wrap_type) {
-            case CaveMap<T>::RangeCheck:
-                CaveMapFuncs::range_check_coords(w, h, x, y);
-                break;
-            case CaveMap<T>::Perfect:
-                CaveMapFuncs::perfect_wrap_coords(w, h, x, y);
-                break;
-            case CaveMap<T>::LineShift:
-                CaveMapFuncs::lineshift_wrap_coords_both(w, h, x, y);
-                break;
-        }
-        return data[y * w + x].boxed_t;
+        /* inside the map every wrap type gives the same cell; this is the
+         * case for nearly all accesses, so check it first, without any modulo.
+         * this keeps the function small enough to be inlined into the engine. */
+        if (unsigned(x) < unsigned(w) && unsigned(y) < unsigned(h))
+            return data[y * w + x].boxed_t;
+        return wrapped(x, y);
     }
     
     const T & operator()(int x, int y) const {
         return const_cast<CaveMap<T>&>(*this)(x, y);    /* const cast, but return const& */
     }
+
+    /// The index of a cell in the map, y*width+x, given by the reference returned by operator().
+    /// Useful to find out where a wrapped coordinate ended up.
+    int index_of(const T &cell) const {
+        return int(reinterpret_cast<const BoxedT *>(&cell) - data.data());
+    }
+
+private:
+    T & wrapped(int x, int y);
 };
 
 
+/* access a cell outside the map, according to the wrap type */
+template <typename T>
+T & CaveMap<T>::wrapped(int x, int y) {
+    switch (wrap_type) {
+        case CaveMap<T>::RangeCheck:
+            CaveMapFuncs::range_check_coords(w, h, x, y);
+            break;
+        case CaveMap<T>::Perfect:
+            CaveMapFuncs::perfect_wrap_coords(w, h, x, y);
+            break;
+        case CaveMap<T>::LineShift:
+            CaveMapFuncs::lineshift_wrap_coords_both(w, h, x, y);
+            break;
+    }
+    return data[y * w + x].boxed_t;
+}
+
+
 /* set size of map; fill all with def */
 template <typename T>
 void CaveMap<T>::set_size(int new_w, int new_h, const T &def) {
@@ -37,33 +37,53 @@ enum { GD_CAVE_SEED_MAX = 65535 };
  * This is the main random generator, which is used during
  * playing the cave. The C64 random generator is only used when
  * creating the cave.
+ *
+ * All numbers are made from g_rand_int(), and the number of calls is counted.
+ * GRand has no way to store its state other than copying it, but a copy of
+ * an earlier state can be brought forward with skip(), which is what the
+ * snapshots of the cave use.
  */
 class RandomGenerator {
 private:
     /// The GRand wrapped - stores the internal state.
     GRand *rand;
+    /// The number of g_rand_int() calls since seeding.
+    guint64 draws;
+
+    guint32 next() {
+        draws++;
+        return g_rand_int(rand);
+    }
 
 public:
+    /// The approximate memory used by a generator; GRand is a Mersenne Twister with 624 words of state.
+    enum { memory_size = 625 * sizeof(guint32) + sizeof(GRand *) + sizeof(guint64) };
+
     /// Create object; initialize randomly
     RandomGenerator() {
         rand = g_rand_new();
+        draws = 0;
     }
 
     /// Create object.
     /// @param seed Random number seed to be used.
     explicit RandomGenerator(unsigned int seed) {
         rand = g_rand_new_with_seed(seed);
+        draws = 0;
     }
 
     RandomGenerator(const RandomGenerator & other) {
         rand = g_rand_copy(other.rand);
+        draws = other.draws;
     }
     RandomGenerator(RandomGenerator && other) {
         rand = other.rand;
+        draws = other.draws;
         other.rand = NULL;
     }
     RandomGenerator &operator=(RandomGenerator rhs) {
         std::swap(rand, rhs.rand);
+        std::swap(draws, rhs.draws);
         return *this;
     }
     ~RandomGenerator() {
@@ -75,23 +95,54 @@ public:
     /// @param seed The seed value.
     void set_seed(unsigned int seed) {
         g_rand_set_seed(rand, seed);
+        draws = 0;
     }
-    
+
+    /// The number of 32-bit numbers generated since seeding.
+    guint64 get_draws() const {
+        return draws;
+    }
+
+    /// Skip numbers, as if they were generated.
+    /// @param count The number of 32-bit numbers to skip.
+    void skip(guint64 count) {
+        for (guint64 i = 0; i < count; ++i)
+            next();
+    }
+
     /// Generater a random boolean. 50% false, 50% true.
+    /// The same as g_rand_boolean().
     bool rand_boolean() {
-        return g_rand_boolean(rand) != FALSE;
+        return (next() & (1 << 15)) != 0;
     }
 
     /// Generate a random integer, [begin, end).
+    /// The same as g_rand_int_range() of GLib 2.2 and later, which
+    /// drops the numbers that would make the distribution uneven.
     /// @param begin Start of interval, inclusive.
     /// @param end End of interval, non-inclusive.
     int rand_int_range(int begin, int end) {
-        return g_rand_int_range(rand, begin, end);
+        g_return_val_if_fail(end > begin, begin);
+        guint32 dist = guint32(end) - guint32(begin);
+        /* maxvalue is the predecessor of the greatest multiple of dist less or equal 2^32 */
+        guint32 maxvalue;
+        if (dist <= 0x80000000u) {
+            guint32 leftover = (0x80000000u % dist) * 2;
+            if (leftover >= dist)
+                leftover -= dist;
+            maxvalue = 0xffffffffu - leftover;
+        } else
+            maxvalue = dist - 1;
+        guint32 random;
+        do
+            random = next();
+        while (random > maxvalue);
+        return begin + gint32(random % dist);
     }
 
     /// Generate a random 32-bit unsigned integer.
     unsigned int rand_int() {
-        return g_rand_int(rand);
+        return next();
     }
 };
 
@@ -24,6 +24,7 @@
 #include "config.h"
 
 #include <vector>
+#include <algorithm>
 #include <sstream>
 #include <cstdio>
 #include <cstring>
@@ -90,6 +91,18 @@ void CaveReplay::rewind() {
     current_playing_pos = 0;
 }
 
+/* continue playing from the given movement; if past the end, no more movements will be returned */
+void CaveReplay::seek(unsigned int pos) {
+    current_playing_pos = std::min<unsigned int>(pos, movements.size());
+}
+
+/* forget the movements after the given length, to continue recording from there */
+void CaveReplay::truncate(unsigned int length) {
+    if (length < movements.size())
+        movements.resize(length);
+    current_playing_pos = std::min<unsigned int>(current_playing_pos, movements.size());
+}
+
 bool CaveReplay::load_one_from_bdcff(const std::string &str) {
     bool up, down, left, right;
     bool fire, suicide;
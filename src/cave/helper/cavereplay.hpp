@@ -58,6 +58,12 @@ public:
     void store_movement(GdDirectionEnum player_move, bool player_fire, bool suicide);
     bool get_next_movement(GdDirectionEnum &player_move, bool &player_fire, bool &suicide);
     void rewind();
+    void seek(unsigned int pos);
+    void truncate(unsigned int length);
+    /// The index of the movement to be returned by the next get_next_movement() call.
+    unsigned int playing_pos() const {
+        return current_playing_pos;
+    }
     unsigned int length() const {
         return movements.size();
     }
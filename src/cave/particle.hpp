@@ -26,63 +26,97 @@
 
 #include "config.h"
 
+#include <glib.h>
 #include <vector>
 #include "cave/colors.hpp"
 
-class ParticleSet {
+/// A set of particles created together, for example by an explosion.
+/// The coordinates and speeds of the particles are stored in the ParticleSystem
+/// which owns the set; the set is a range of them, and holds the properties
+/// common to all of its particles.
+struct ParticleSet {
+    unsigned first;     ///< Index of the first particle in the arrays of the ParticleSystem
+    unsigned count;     ///< Number of particles
+    GdColor color;
+    int life;           ///< lifetime. starts from 1000, goes to 0.
+    bool is_new;        ///< New particle set, the coordinates of which must be "normalized" to the cave screen coordinates
+    float size;         ///< Size of the particles.
+    float opacity;      ///< Opacity between 0 and 1. Values close to 1 not recommended.
+};
+
+
+/// All the particles of a cave, in a pool of fixed capacity.
+/// The coordinates and the speeds of the particles are stored in separate
+/// arrays, so moving them is a simple loop which the compiler can vectorize.
+/// Every set has the same lifetime, so the sets die in the order they were
+/// created; both the sets and the particles are stored in ring buffers, and
+/// the space of the dead ones is reused. The pool is allocated when the first
+/// set is added, so after that there is no memory allocation at all.
+/// If the pool is full, new particle sets are silently dropped.
+class ParticleSystem {
 public:
-    /// One single particle.
-    struct Particle {
-        float px, py;         ///< Coordinate
-        float vx, vy;         ///< Speed
+    enum {
+        MaxParticles = 32768,   ///< Capacity of the pool
+        MaxSets = 4096,         ///< Maximum number of particle sets alive at the same time
+        ParticleBlock = 8,      ///< The particles of a set are reserved in blocks of this size, for vectorization
     };
 
-    /// This constructor creates a particle set, for the given cave coordinates.
+    /// Add a particle set, for the given cave coordinates.
     /// 0,0 is the top left corner of the cave; 1,1 is the bottom right corner of
     /// the top left cave cell. (So the max coordinates are the width and height
     /// of the cave.)
-    /// @param cave_x Particle set starting x coordinate in cave coordinates.
-    /// @param cave_y Particle set starting y coordinate in cave coordinates.
-    /// @param dx Half the width of the region, in which originally particles are randomly generated.
-    /// @param dy Half the height of the region, in which originally particles are randomly generated.
-    /// @param vx Maximum original speed.
-    /// @param vy Maximum original speed.
-    ParticleSet(int count, float size, float opacity, float p0x, float p0y, float dp0x, float dp0y, float v0x, float v0y, float dvx, float dvy, const GdColor &color);
-    /// Move the particles.
+    /// @param count Number of particles.
+    /// @param size Size of the particles, in cave cells.
+    /// @param opacity Opacity of the particles.
+    /// @param p0x Particle set starting x coordinate in cave coordinates.
+    /// @param p0y Particle set starting y coordinate in cave coordinates.
+    /// @param dp0x Half the width of the region, in which originally particles are randomly generated.
+    /// @param dp0y Half the height of the region, in which originally particles are randomly generated.
+    /// @param v0x Original speed.
+    /// @param v0y Original speed.
+    /// @param dvx Maximum random difference from the original speed.
+    /// @param dvy Maximum random difference from the original speed.
+    /// @param color Color of the particles.
+    void add(int count, float size, float opacity, float p0x, float p0y, float dp0x, float dp0y, float v0x, float v0y, float dvx, float dvy, const GdColor &color);
+    /// Move the particles, and forget the sets which died.
     /// @param dt_ms Time elapsed.
     void move(int dt_ms);
-    /// Scale coordinates to screen cordinates, if is_new is true.
+    /// Scale coordinates of the new sets to screen cordinates.
     /// @param factor The number of pixels per cell on the screen.
     void normalize(double factor);
+    /// Remove all particles.
+    void clear();
 
-    typedef std::vector<Particle> container;
-    typedef container::iterator iterator;
-    typedef container::const_iterator const_iterator;
-
-    iterator begin() {
-        return particles.begin();
+    /// Number of particle sets alive.
+    unsigned num_sets() const {
+        return set_count;
     }
-    iterator end() {
-        return particles.end();
+    /// The ith particle set alive; the oldest one is the 0th.
+    ParticleSet const &set(unsigned i) const {
+        return sets[(set_head + i) % MaxSets];
     }
-    const_iterator begin() const {
-        return particles.begin();
+    /// X coordinates of the particles, to be indexed by the ranges of the sets.
+    float const *px() const {
+        return x.data();
     }
-    const_iterator end() const {
-        return particles.end();
-    }
-    size_t num_particles() const {
-        return particles.size();
+    /// Y coordinates of the particles, to be indexed by the ranges of the sets.
+    float const *py() const {
+        return y.data();
     }
 
-    GdColor color;
-    int life;           ///< lifetime. starts from 1000, goes to 0.
-    bool is_new;        ///< New particle set, the coordinates of which must be "normalized" to the cave screen coordinates
-    float size;         ///< Size of the particles.
-    float opacity;      ///< Opacity between 0 and 1. Values close to 1 not recommended.
-
 private:
-    container particles;
+    std::vector<float> x, y, vx, vy;
+    std::vector<ParticleSet> sets;
+    unsigned set_head = 0;      ///< index of the oldest set in sets
+    unsigned set_count = 0;     ///< number of sets alive
+    unsigned next_free = 0;     ///< index of the particle after the last one of the newest set
+    guint32 random_state = 0;   ///< state of the xorshift random number generator
+
+    float random_range(float min, float max);
+    /// The number of particles reserved for a set of count particles: a whole number of blocks.
+    static unsigned blocks_of(unsigned count) {
+        return (count + ParticleBlock - 1) / ParticleBlock * ParticleBlock;
+    }
 };
 
 #endif
@@ -163,6 +163,19 @@ void GameActivity::keypress_event(KeyCode keycode, int gfxlib_keycode) {
             else
                 gd_message(_("No snapshot saved.")); //app->show_message(_("No snapshot saved."));
             break;
+        case RewindKey: {
+            bool was_rewound = game->rewound;
+            if (game->rewind() && !was_rewound && game->type == GameControl::TYPE_NORMAL)
+                gd_message(_("Cave rewound, no highscore for this game."));
+            break;
+        }
+        case RewindForwardKey:
+            game->forward();
+            break;
+        case ReplaySpeedKey:
+            if (game->type == GameControl::TYPE_REPLAY)
+                game->next_replay_speed();
+            break;
         case CaveVariablesKey:
             gd_sound_off();
             app->show_text_and_do_command(_("Cave Information"), info_and_variables_of_cave(game->original_cave, game->played_cave.get()));
@@ -202,7 +215,7 @@ void GameActivity::timer_event(int ms_elapsed) {
         /* there might be a command to be run after the game. if there is no highscore,
          * the game object will execute it, when popping. if there is a highscoresactivity
          * object, the command to be run is passed to it. */
-        if (show_highscore && game->caveset->highscore.is_highscore(game->player_name, game->player_score)) {
+        if (show_highscore && !game->rewound && game->caveset->highscore.is_highscore(game->player_name, game->player_score)) {
             /* enter to highscore table */
             int rank = game->caveset->highscore.add(game->player_name, game->player_score);
             app->enqueue_command(std::make_unique<ShowHighScoreCommand>(app, nullptr, rank));
@@ -60,6 +60,9 @@ public:
         RandomColorKey = App::F2,
         TakeSnapshotKey = App::F3,
         RevertToSnapshotKey = App::F4,
+        RewindKey = App::F5,
+        RewindForwardKey = App::F6,
+        ReplaySpeedKey = App::F7,
         PauseKey = ' ',
         CaveVariablesKey = App::F8,
     };
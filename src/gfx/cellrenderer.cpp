@@ -28,6 +28,7 @@
 #include "gfx/cellrenderer.hpp"
 
 #include "misc/logger.hpp"
+#include "misc/threadpool.hpp"
 #include "gfx/pixbuf.hpp"
 #include "gfx/pixbuffactory.hpp"
 #include "gfx/screen.hpp"
@@ -46,30 +47,110 @@ CellRenderer::CellRenderer(Screen &screen, const std::string &theme_file)
         color3(GD_GDASH_WHITE),
         color4(GD_GDASH_WHITE),
         color5(GD_GDASH_WHITE),
+        preparing_cancelled(false),
+        prepared_scaling_factor(1.0),
+        prepared_scaling_type(GD_SCALING_NEAREST),
+        prepared_pal_emulation(false),
         screen(screen) {
+    for (unsigned i = 0; i < G_N_ELEMENTS(prepared_ready); ++i)
+        prepared_ready[i] = false;
     load_theme_file(theme_file);
 }
 
 
+CellRenderer::~CellRenderer() {
+    cancel_preparing();
+}
+
+
 /** Remove colored Pixbufs and Pixmaps created. */
 void CellRenderer::remove_cached() {
+    cancel_preparing();
     for (unsigned i = 0; i < G_N_ELEMENTS(cells_pixbufs); ++i) {
         cells_pixbufs[i].reset();
     }
-    CellRenderer::release_pixmaps();
+    release_cells();
     if (is_c64_colored) {
         cells_all.reset();
     }
 }
 
 
-void CellRenderer::release_pixmaps() {
+void CellRenderer::release_cells() {
     for (unsigned i = 0; i < G_N_ELEMENTS(cells); ++i) {
         cells[i].reset();
     }
 }
 
 
+void CellRenderer::release_pixmaps() {
+    cancel_preparing();
+    /* the cached pixmaps belong to the screen as well */
+    colors_cache.clear();
+    release_cells();
+}
+
+
+/** Move the cells of the current colors to the cache, and drop the least
+ * recently used colors if the cache is too big. */
+void CellRenderer::store_colors_in_cache() {
+    /* the cells already prepared are kept with the colors */
+    take_prepared_cells();
+    cancel_preparing();
+    if (cells_all == NULL)
+        return;
+
+    CachedColors cached;
+    cached.color0 = color0;
+    cached.color1 = color1;
+    cached.color2 = color2;
+    cached.color3 = color3;
+    cached.color4 = color4;
+    cached.color5 = color5;
+    cached.scaling_factor = screen.get_pixmap_scale();
+    cached.scaling_type = screen.get_scaling_type();
+    cached.pal_emulation = screen.get_pal_emulation();
+    cached.bytes = cells_all->get_width() * cells_all->get_height() * 4;
+    cached.cells_all = std::move(cells_all);
+    for (unsigned i = 0; i < G_N_ELEMENTS(cells_pixbufs); ++i)
+        cached.cells_pixbufs[i] = std::move(cells_pixbufs[i]);
+    for (unsigned i = 0; i < G_N_ELEMENTS(cells); ++i) {
+        if (cells[i] != NULL)
+            cached.bytes += cells[i]->get_width() * cells[i]->get_height() * 4;
+        cached.cells[i] = std::move(cells[i]);
+    }
+    colors_cache.push_front(std::move(cached));
+
+    size_t total = 0;
+    for (std::list<CachedColors>::iterator it = colors_cache.begin(); it != colors_cache.end(); ++it) {
+        total += it->bytes;
+        if (total > colors_cache_budget) {
+            colors_cache.erase(it, colors_cache.end());
+            break;
+        }
+    }
+}
+
+
+/** If the cells for the current colors are in the cache, take them. */
+void CellRenderer::restore_colors_from_cache() {
+    for (std::list<CachedColors>::iterator it = colors_cache.begin(); it != colors_cache.end(); ++it) {
+        if (it->color0 == color0 && it->color1 == color1 && it->color2 == color2
+            && it->color3 == color3 && it->color4 == color4 && it->color5 == color5
+            && it->scaling_factor == screen.get_pixmap_scale() && it->scaling_type == screen.get_scaling_type()
+            && it->pal_emulation == screen.get_pal_emulation()) {
+            cells_all = std::move(it->cells_all);
+            for (unsigned i = 0; i < G_N_ELEMENTS(cells_pixbufs); ++i)
+                cells_pixbufs[i] = std::move(it->cells_pixbufs[i]);
+            for (unsigned i = 0; i < G_N_ELEMENTS(cells); ++i)
+                cells[i] = std::move(it->cells[i]);
+            colors_cache.erase(it);
+            return;
+        }
+    }
+}
+
+
 
 Pixbuf &CellRenderer::cell_pixbuf(unsigned i) {
     g_assert(i < G_N_ELEMENTS(cells_pixbufs));
@@ -81,33 +162,123 @@ Pixbuf &CellRenderer::cell_pixbuf(unsigned i) {
     return *cells_pixbufs[i];
 }
 
+/**
+ * Create the scaled pixbuf of a cell.
+ * It only reads the pixbuf and the settings given, so it can run on any thread.
+ * @param pb The pixbuf of the cell.
+ * @param type 0=normal, 1=colored for flashing, 2=colored for selection.
+ */
+std::unique_ptr<Pixbuf> CellRenderer::create_scaled_cell(Pixbuf const &pb, int type, double scaling_factor, GdScalingType scaling_type, bool pal_emulation) const {
+    switch (type) {
+        case 0:
+            return screen.pixbuf_factory.create_scaled(pb, scaling_factor, scaling_type, pal_emulation);
+        case 1: {
+            std::unique_ptr<Pixbuf> colored(screen.pixbuf_factory.create_composite_color(pb, gd_flash_color));
+            return screen.pixbuf_factory.create_scaled(*colored, scaling_factor, scaling_type, pal_emulation);
+        }
+        case 2: {
+            std::unique_ptr<Pixbuf> colored(screen.pixbuf_factory.create_composite_color(pb, gd_select_color));
+            return screen.pixbuf_factory.create_scaled(*colored, scaling_factor, scaling_type, pal_emulation);
+        }
+        default:
+            g_assert_not_reached();
+            return NULL;
+    }
+}
+
+
 Pixmap &CellRenderer::cell(unsigned i) {
     g_assert(i < G_N_ELEMENTS(cells));
+    if (cells[i] == NULL)
+        take_prepared_cell(i);
     if (cells[i] == NULL) {
         int type = i / NUM_OF_CELLS;  // 0=normal, 1=colored1, 2=colored2
         int index = i % NUM_OF_CELLS;
         Pixbuf &pb = cell_pixbuf(index);    // this is to be rendered as a pixmap, but may be colored
+        std::unique_ptr<Pixbuf> scaled = create_scaled_cell(pb, type, screen.get_pixmap_scale(), screen.get_scaling_type(), screen.get_pal_emulation());
+        cells[i] = screen.create_pixmap_from_pixbuf(*scaled, false);
+    }
+    return *cells[i];
+}
 
-        switch (type) {
-            case 0:
-                cells[i] = screen.create_scaled_pixmap_from_pixbuf(pb, false);
-                break;
-            case 1: {
-                std::unique_ptr<Pixbuf> colored(screen.pixbuf_factory.create_composite_color(pb, gd_flash_color));
-                cells[i] = screen.create_scaled_pixmap_from_pixbuf(*colored, false);
-            }
-            break;
-            case 2: {
-                std::unique_ptr<Pixbuf> colored(screen.pixbuf_factory.create_composite_color(pb, gd_select_color));
-                cells[i] = screen.create_scaled_pixmap_from_pixbuf(*colored, false);
-            }
-            break;
-            default:
-                g_assert_not_reached();
-                break;
+
+void CellRenderer::prepare_cells() {
+    cancel_preparing();
+
+    /* the pixbufs of the cells are created here, so the worker threads only read them.
+     * the cells after the ones in the image are only used by the editor. */
+    unsigned const image_cells = NUM_OF_CELLS_X * NUM_OF_CELLS_Y;
+    std::vector<std::pair<Pixbuf const *, unsigned>> jobs;
+    for (unsigned i = 0; i < G_N_ELEMENTS(cells); ++i) {
+        unsigned index = i % NUM_OF_CELLS;
+        if (cells[i] == NULL && index < image_cells)
+            jobs.push_back(std::make_pair(&cell_pixbuf(index), i));
+    }
+    if (jobs.empty())
+        return;
+
+    prepared.clear();
+    prepared.resize(G_N_ELEMENTS(cells));
+    prepared_scaling_factor = screen.get_pixmap_scale();
+    prepared_scaling_type = screen.get_scaling_type();
+    prepared_pal_emulation = screen.get_pal_emulation();
+    for (unsigned i = 0; i < G_N_ELEMENTS(prepared_ready); ++i)
+        prepared_ready[i] = false;
+    preparing_cancelled = false;
+    preparing = std::async(std::launch::async, [this, jobs] {
+        gd_parallel_for(jobs.size(), [this, &jobs] (unsigned j) {
+            if (preparing_cancelled)
+                return;
+            unsigned i = jobs[j].second;
+            prepared[i] = create_scaled_cell(*jobs[j].first, i / NUM_OF_CELLS,
+                                             prepared_scaling_factor, prepared_scaling_type, prepared_pal_emulation);
+            prepared_ready[i].store(true, std::memory_order_release);
+        });
+    });
+}
+
+
+/** If the background job of prepare_cells() has already scaled the cell, create its pixmap.
+ * This does not wait for the job; the pixbufs of the other cells may still be written. */
+void CellRenderer::take_prepared_cell(unsigned i) {
+    if (!preparing.valid() || !prepared_ready[i].load(std::memory_order_acquire))
+        return;
+    /* if the screen changed in the meantime, the cell will be created again when needed */
+    if (prepared_scaling_factor == screen.get_pixmap_scale() && prepared_scaling_type == screen.get_scaling_type()
+        && prepared_pal_emulation == screen.get_pal_emulation())
+        cells[i] = screen.create_pixmap_from_pixbuf(*prepared[i], false);
+    prepared[i].reset();
+    prepared_ready[i] = false;
+}
+
+
+/** Create the pixmaps of all cells the background job has finished so far. */
+void CellRenderer::take_prepared_cells() {
+    for (unsigned i = 0; i < G_N_ELEMENTS(cells); ++i)
+        if (cells[i] == NULL)
+            take_prepared_cell(i);
+}
+
+
+void CellRenderer::wait_for_prepared_cells() {
+    if (!preparing.valid())
+        return;
+    preparing.wait();
+    take_prepared_cells();
+}
+
+
+/** Stop the background job of prepare_cells(), if there is one, and throw away its results. */
+void CellRenderer::cancel_preparing() {
+    if (preparing.valid()) {
+        preparing_cancelled = true;
+        try {
+            preparing.get();
+        } catch (std::exception &e) {
+            gd_warning("cannot prepare cells: %s", e.what());
         }
     }
-    return *cells[i];
+    prepared.clear();
 }
 
 /* check if given surface is ok to be a gdash theme. */
@@ -144,6 +315,7 @@ bool CellRenderer::loadcells_image(std::unique_ptr<Pixbuf> image) {
 
     /* remove old stuff */
     remove_cached();
+    colors_cache.clear();
     loaded.reset();
 
     /* load new stuff */
@@ -197,6 +369,11 @@ int CellRenderer::get_cell_size() {
 void CellRenderer::select_pixbuf_colors(GdColor c0, GdColor c1, GdColor c2, GdColor c3, GdColor c4, GdColor c5) {
     if (c0 != color0 || c1 != color1 || c2 != color2 || c3 != color3 || c4 != color4 || c5 != color5) {
         /* if not the same colors as requested before */
+        /* keep the cells of the old colors, as they may be used again */
+        if (is_c64_colored) {
+            store_colors_in_cache();
+            remove_cached();
+        }
         color0 = c0;
         color1 = c1;
         color2 = c2;
@@ -204,7 +381,7 @@ void CellRenderer::select_pixbuf_colors(GdColor c0, GdColor c1, GdColor c2, GdCo
         color4 = c4;
         color5 = c5;
         if (is_c64_colored)
-            remove_cached();
+            restore_colors_from_cache();
     }
 }
 
@@ -237,6 +414,15 @@ c64_color_index(int h, int s, int v, int a) {
 }
 
 
+/* the index of a pixel which has only 0 and 255 bytes, from 0 to 15.
+ * bit n of the index is the lowest bit of byte n of the pixel. */
+static inline unsigned
+c64_pixel_index(guint32 pixel) {
+    guint32 bits = pixel & 0x01010101;
+    return (bits | bits >> 7 | bits >> 14 | bits >> 21) & 0xf;
+}
+
+
 /* returns true, if the given pixbuf seems to be a c64 imported image. */
 bool CellRenderer::check_if_pixbuf_c64_png(Pixbuf const &image) {
     int wx = image.get_width() * 4;   // 4 bytes/pixel
@@ -299,42 +485,56 @@ void CellRenderer::create_colorized_cells() {
     colsrgb[7] = colshsv[7].to_rgb();  /* white, opaque */
     colsrgb[8] = colshsv[8].to_rgb();  /* for the transparent */
 
+    /* colorize a pixel of the loaded image */
+    Pixbuf const &from = *loaded;
+    auto colorize = [&](guint32 pixel) -> guint32 {
+        /* rgb values found in image */
+        unsigned r = (pixel & from.rmask) >> from.rshift;
+        unsigned g = (pixel & from.gmask) >> from.gshift;
+        unsigned b = (pixel & from.bmask) >> from.bshift;
+        unsigned a = (pixel & from.amask) >> from.ashift;
+        unsigned short inh;
+        unsigned char ins, inv;
+        GdColor::from_rgb(r, g, b).get_hsv(inh, ins, inv);
+
+        /* the color code from the original image (essentially the hue) will select the color index */
+        unsigned index = c64_color_index(inh, ins, inv, a);
+
+        /* and then shade it, and convert to rgb */
+        unsigned char resr, resg, resb;
+        if (index == 0 || index >= 6) {
+            /* for the background and the editor colors, no shading is used */
+            colsrgb[index].get_rgb(resr, resg, resb);
+        } else {
+            /* otherwise the saturation and value from the original image will modify it */
+            unsigned short pixh;
+            unsigned char pixs, pixv;
+            colshsv[index].get_hsv(pixh, pixs, pixv);
+            GdColor::from_hsv(pixh, pixs * ins / 100, pixv * inv / 100).get_rgb(resr, resg, resb);
+        }
+
+        return resr << Pixbuf::rshift | resg << Pixbuf::gshift | resb << Pixbuf::bshift | a << Pixbuf::ashift;
+    };
+
+    /* the image passed check_if_pixbuf_c64_png(), so every byte of every pixel is either 0 or 255.
+     * so there are only 16 different pixels; these are colorized first, and then the
+     * image is converted by looking up the pixels in the table. */
+    guint32 colorized[16];
+    for (unsigned i = 0; i < 16; ++i) {
+        guint32 pixel = 0;
+        for (unsigned byte = 0; byte < 4; ++byte)
+            if (i & (1 << byte))
+                pixel |= 0xffu << (byte * 8);
+        colorized[i] = colorize(pixel);
+    }
+
     int w = loaded->get_width(), h = loaded->get_height();
     cells_all = screen.pixbuf_factory.create(w, h);
 
     for (int y = 0; y < h; y++) {
         const guint32 *p = loaded->get_row(y);
         guint32 *to = cells_all->get_row(y);
-        for (int x = 0; x < w; x++) {
-            /* rgb values found in image */
-            unsigned r = (p[x] & loaded->rmask) >> loaded->rshift;
-            unsigned g = (p[x] & loaded->gmask) >> loaded->gshift;
-            unsigned b = (p[x] & loaded->bmask) >> loaded->bshift;
-            unsigned a = (p[x] & loaded->amask) >> loaded->ashift;
-            unsigned short inh;
-            unsigned char ins, inv;
-            GdColor::from_rgb(r, g, b).get_hsv(inh, ins, inv);
-
-            /* the color code from the original image (essentially the hue) will select the color index */
-            unsigned index = c64_color_index(inh, ins, inv, a);
-
-            /* and then shade it, and convert to rgb */
-            unsigned char resr, resg, resb;
-            if (index == 0 || index >= 6) {
-                /* for the background and the editor colors, no shading is used */
-                colsrgb[index].get_rgb(resr, resg, resb);
-            } else {
-                /* otherwise the saturation and value from the original image will modify it */
-                unsigned short pixh;
-                unsigned char pixs, pixv;
-                colshsv[index].get_hsv(pixh, pixs, pixv);
-                GdColor::from_hsv(pixh, pixs * ins / 100, pixv * inv / 100).get_rgb(resr, resg, resb);
-            }
-
-            guint32 newcolword =
-                resr << cells_all->rshift | resg << cells_all->gshift | resb << cells_all->bshift | a << cells_all->ashift;
-
-            to[x] = newcolword;
-        }
+        for (int x = 0; x < w; x++)
+            to[x] = colorized[c64_pixel_index(p[x])];
     }
 }
@@ -27,6 +27,9 @@
 #define CELLRENDERER_HPP_INCLUDED
 
 #include <vector>
+#include <list>
+#include <future>
+#include <atomic>
 
 #include "cave/cavetypes.hpp"
 #include "cave/colors.hpp"
@@ -67,7 +70,45 @@ protected:
     /// If using c64 gfx, these store the current color theme.
     GdColor color0, color1, color2, color3, color4, color5;
 
+    /// The scaled pixbufs of the cells, created in the background by prepare_cells().
+    /// Indexed like cells; turned into pixmaps when the cell is requested.
+    std::vector<std::unique_ptr<Pixbuf>> prepared;
+    /// Set by the background job when the pixbuf of the cell is in prepared.
+    std::atomic<bool> prepared_ready[3 * NUM_OF_CELLS];
+    /// The background job of prepare_cells(), if there is one.
+    std::future<void> preparing;
+    /// Set to make the background job stop early.
+    std::atomic<bool> preparing_cancelled;
+    /// The scaling the background job uses; the pixbufs are useless if the screen changed since.
+    double prepared_scaling_factor;
+    GdScalingType prepared_scaling_type;
+    bool prepared_pal_emulation;
+
+    /// Cells created for a color theme which is not used at the moment.
+    /// When switching back to that theme, the cells need not be colorized and scaled again.
+    struct CachedColors {
+        GdColor color0, color1, color2, color3, color4, color5;
+        double scaling_factor;
+        GdScalingType scaling_type;
+        bool pal_emulation;
+        std::unique_ptr<Pixbuf> cells_all;
+        std::unique_ptr<Pixbuf> cells_pixbufs[NUM_OF_CELLS];
+        std::unique_ptr<Pixmap> cells[3 * NUM_OF_CELLS];
+        size_t bytes;   ///< The estimated memory used by the images.
+    };
+    /// The cached color themes, the most recently used first.
+    std::list<CachedColors> colors_cache;
+    /// The memory the cached color themes may use.
+    static size_t const colors_cache_budget = 128 * 1024 * 1024;
+    void store_colors_in_cache();
+    void restore_colors_from_cache();
+
+    std::unique_ptr<Pixbuf> create_scaled_cell(Pixbuf const &pb, int type, double scaling_factor, GdScalingType scaling_type, bool pal_emulation) const;
+    void take_prepared_cell(unsigned i);
+    void take_prepared_cells();
+    void cancel_preparing();
     void create_colorized_cells();
+    void release_cells();
     bool loadcells_image(std::unique_ptr<Pixbuf> loadcells_image);
     bool loadcells_file(const std::string &filename);
     virtual void remove_cached();
@@ -83,7 +124,7 @@ public:
     virtual void release_pixmaps();
 
     /// Destructor.
-    virtual ~CellRenderer() = default;
+    virtual ~CellRenderer();
 
     /// @brief Loads a new theme.
     /// The theme_file can be a file name of a png file, or empty.
@@ -95,6 +136,17 @@ public:
     /// @brief Returns a particular cell.
     Pixmap &cell(unsigned i);
 
+    /// @brief Start creating all the cells for the screen in the background.
+    /// The cells are scaled on worker threads, so the game does not stop
+    /// when an element is drawn for the first time. cell() never waits for the job;
+    /// it takes the cell if the job has already finished it, or scales it itself.
+    /// Call this when the colors are selected.
+    void prepare_cells();
+
+    /// @brief Wait for the job of prepare_cells() and take all cells it created.
+    /// The game does not need this; it is for measuring the preparation.
+    void wait_for_prepared_cells();
+
     /// @brief Returns the size of the pixmaps stored.
     /// They are squares, so there is only one function, not two for width and height.
     int get_cell_size();
@@ -42,37 +42,28 @@ static_assert(G_N_ELEMENTS(gd_scaling_names) == GD_SCALING_MAX + 1); /* +1 is th
 
 
 
-/* scales a pixbuf with the appropriate scaling type. */
-std::unique_ptr<Pixbuf> PixbufFactory::create_scaled(const Pixbuf &src, double scaling_factor, GdScalingType scaling_type, bool pal_emulation) const {
+/* the largest factor, not larger than the given one, for which create_scaled_integer() has an algorithm. */
+static int largest_kernel_factor(double scaling_factor) {
+    int const factors[] = {8, 6, 4, 3, 2};
+    for (int factor : factors)
+        if (factor <= scaling_factor)
+            return factor;
+    return 1;
+}
 
-    // title screen: calculate scaling factor
-    if ((gd_view_width > 20 || gd_view_height > 13) && src.get_width() >= 100 && src.get_height() >= 100) {
-        int w = gd_view_width * 16;
-        int h = (gd_view_height + 1 - 3) * 16; // three lines for game and cave title
-        // estimate monitor size
-        int monitor_width = w * scaling_factor;
-        int monitor_height = h * scaling_factor;
-        double ratioW = (double) monitor_width / (double) src.get_width();
-        double ratioH = (double) monitor_height / (double) src.get_height();
-        double ratio = std::min(ratioW, ratioH);
-        // ratio = x * DOUBLE_STEP + y
-        double x = std::round(ratio / DOUBLE_STEP);
-        double r = x * DOUBLE_STEP;
-        if (r > ratio)
-            r -= DOUBLE_STEP;
-        int newWidth = (int) (src.get_width() * r);
-        int newHeight = (int) (src.get_height() * r);
-        gd_debug("title_screen: %u x %u max_size: %u x %u upscaled: %u x %u ratio=%f -> %f",
-                src.get_width(), src.get_height(), monitor_width, monitor_height, newWidth, newHeight, ratio, r);
-        scaling_factor = r;
+
+/* scales a pixbuf with the appropriate pixel art scaling algorithm, by an integer factor. */
+std::unique_ptr<Pixbuf> PixbufFactory::create_scaled_integer(const Pixbuf &src, int scaling_factor, GdScalingType scaling_type) const {
+    // NOTE: integer scaling factors 1-4 have special algorithms, 6 and 8 are composed of them
+    if (scaling_factor == 6 || scaling_factor == 8) {
+        std::unique_ptr<Pixbuf> first = create_scaled_integer(src, scaling_factor / 2, scaling_type);
+        return create_scaled_integer(*first, 2, scaling_type);
     }
 
     std::unique_ptr<Pixbuf> scaled = this->create(src.get_width() * scaling_factor, src.get_height() * scaling_factor);
-
-    // NOTE: integer scaling factors 1-4 have special algorithms
-    if (scaling_factor == 1.0) {
+    if (scaling_factor == 1) {
         src.copy(*scaled, 0, 0);
-    } else if (scaling_factor == 2.0) {
+    } else if (scaling_factor == 2) {
         switch (scaling_type) {
             case GD_SCALING_NEAREST:
                 scale2xnearest(src, *scaled);
@@ -87,7 +78,7 @@ std::unique_ptr<Pixbuf> PixbufFactory::create_scaled(const Pixbuf &src, double s
                 g_assert_not_reached();
                 break;
         }
-    } else if (scaling_factor == 3.0) {
+    } else if (scaling_factor == 3) {
         switch (scaling_type) {
             case GD_SCALING_NEAREST:
                 scale3xnearest(src, *scaled);
@@ -102,7 +93,7 @@ std::unique_ptr<Pixbuf> PixbufFactory::create_scaled(const Pixbuf &src, double s
                 g_assert_not_reached();
                 break;
         }
-    } else if (scaling_factor == 4.0) {
+    } else if (scaling_factor == 4) {
         switch (scaling_type) {
             case GD_SCALING_NEAREST:
                 /* 2x nearest applied twice. */
@@ -128,7 +119,52 @@ std::unique_ptr<Pixbuf> PixbufFactory::create_scaled(const Pixbuf &src, double s
                 break;
         }
     } else {
-        src.scale(*scaled, scaling_factor, scaling_type);
+        g_assert_not_reached();
+    }
+
+    return scaled;
+}
+
+
+/* scales a pixbuf with the appropriate scaling type. */
+std::unique_ptr<Pixbuf> PixbufFactory::create_scaled(const Pixbuf &src, double scaling_factor, GdScalingType scaling_type, bool pal_emulation) const {
+
+    // title screen: calculate scaling factor
+    if ((gd_view_width > 20 || gd_view_height > 13) && src.get_width() >= 100 && src.get_height() >= 100) {
+        int w = gd_view_width * 16;
+        int h = (gd_view_height + 1 - 3) * 16; // three lines for game and cave title
+        // estimate monitor size
+        int monitor_width = w * scaling_factor;
+        int monitor_height = h * scaling_factor;
+        double ratioW = (double) monitor_width / (double) src.get_width();
+        double ratioH = (double) monitor_height / (double) src.get_height();
+        double ratio = std::min(ratioW, ratioH);
+        // ratio = x * DOUBLE_STEP + y
+        double x = std::round(ratio / DOUBLE_STEP);
+        double r = x * DOUBLE_STEP;
+        if (r > ratio)
+            r -= DOUBLE_STEP;
+        int newWidth = (int) (src.get_width() * r);
+        int newHeight = (int) (src.get_height() * r);
+        gd_debug("title_screen: %u x %u max_size: %u x %u upscaled: %u x %u ratio=%f -> %f",
+                src.get_width(), src.get_height(), monitor_width, monitor_height, newWidth, newHeight, ratio, r);
+        scaling_factor = r;
+    }
+
+    std::unique_ptr<Pixbuf> scaled;
+    int const kernel_factor = largest_kernel_factor(scaling_factor);
+    if (kernel_factor == scaling_factor) {
+        scaled = create_scaled_integer(src, kernel_factor, scaling_type);
+    } else if (scaling_type == GD_SCALING_NEAREST) {
+        scaled = this->create(src.get_width() * scaling_factor, src.get_height() * scaling_factor);
+        scale_nearest(src, *scaled);
+    } else {
+        /* enlarge with the pixel art scalers as much as possible, then the rest with the smooth filter. */
+        scaled = this->create(src.get_width() * scaling_factor, src.get_height() * scaling_factor);
+        if (kernel_factor > 1)
+            scale_smooth(*create_scaled_integer(src, kernel_factor, scaling_type), *scaled);
+        else
+            scale_smooth(src, *scaled);
     }
 
     if (pal_emulation)
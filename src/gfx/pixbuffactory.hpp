@@ -84,8 +84,11 @@ public:
     virtual std::unique_ptr<Pixbuf> create_subpixbuf(Pixbuf &src, int x, int y, int w, int h) const = 0;
 
     /// @brief Use the selected software scaled to create a new, enlarged pixbuf.
+    /// Factors 1x, 2x, 3x, 4x, 6x and 8x use the pixel art scaling algorithms.
+    /// Other factors enlarge with them as much as possible, and do the rest
+    /// with a smooth filter (or use nearest neighbor, if that is the selected type).
     /// @param src The pixbuf to scale.
-    /// @param scaling_factor The factor of enlargement, 1x, 2x, 3x or 4x.
+    /// @param scaling_factor The factor of enlargement.
     /// @param scaling_type The scaling algorithm.
     /// @param pal_emulation Whether to add a PAL TV effect.
     /// @return The scaled pixbuf, to be freed by the caller.
@@ -101,6 +104,9 @@ public:
 
     /// Creates a new, rotated pixbuf.
     virtual std::unique_ptr<Pixbuf> create_rotated(const Pixbuf &src, Rotation r) const = 0;
+
+private:
+    std::unique_ptr<Pixbuf> create_scaled_integer(const Pixbuf &src, int scaling_factor, GdScalingType scaling_type) const;
 };
 
 #endif
@@ -25,10 +25,19 @@
 
 #include <cstring>
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__SSE2__) && G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define PAL_EMU_SSE2
+#endif
 
 #include "settings.hpp"
 #include "gfx/pixbuf.hpp"
 #include "cave/colors.hpp"
+#include "misc/threadpool.hpp"
 
 /* somewhat optimized implementation of the Scale2x algorithm. */
 /* http://scale2x.sourceforge.net */
@@ -170,6 +179,157 @@ void scale3x(const Pixbuf &src, Pixbuf &dest) {
 }
 
 
+/* nearest neighbor scaling, for any factor. the size of the destination
+ * pixbuf decides the factor, and it can be different horizontally and vertically. */
+void scale_nearest(const Pixbuf &src, Pixbuf &dest) {
+    int const sw = src.get_width(), sh = src.get_height();
+    int const dw = dest.get_width(), dh = dest.get_height();
+    if (sw == 0 || sh == 0)
+        return;
+
+    /* the source pixel is the one under the center of the destination pixel */
+    std::vector<int> source_x(dw);
+    for (int x = 0; x < dw; ++x)
+        source_x[x] = std::min(sw - 1, int((2 * gint64(x) + 1) * sw / (2 * dw)));
+
+    int previous_y = -1;
+    for (int y = 0; y < dh; ++y) {
+        int sy = std::min(sh - 1, int((2 * gint64(y) + 1) * sh / (2 * dh)));
+        guint32 *dstpix = dest.get_row(y);
+        if (sy == previous_y) {
+            /* same source row as for the previous one, make a fast copy */
+            memcpy(dstpix, dest.get_row(y - 1), 4 * dw);
+            continue;
+        }
+        guint32 const *srcpix = src.get_row(sy);
+        for (int x = 0; x < dw; ++x)
+            dstpix[x] = srcpix[source_x[x]];
+        previous_y = sy;
+    }
+}
+
+
+/* the source pixels, which make up the destination pixels along one axis
+ * in scale_smooth(). the filter is a tent: when enlarging, it interpolates
+ * linearly between the two nearest pixels; when shrinking, it is widened,
+ * so every source pixel has its share in the result. every destination
+ * pixel has the same number of taps, the unused ones have zero weight. */
+class SmoothFilterAxis {
+public:
+    int taps;
+    std::vector<int> index;       /* dest_size * taps source coordinates, clamped to the image */
+    std::vector<float> weight;    /* dest_size * taps weights; the weights of a pixel add up to 1 */
+
+    SmoothFilterAxis(int src_size, int dest_size) {
+        double scale = double(dest_size) / src_size;
+        double radius = std::max(1.0, 1.0 / scale);
+        taps = 2 * int(std::ceil(radius)) + 1;
+        index.resize(dest_size * taps);
+        weight.resize(dest_size * taps);
+        for (int d = 0; d < dest_size; ++d) {
+            double center = (d + 0.5) / scale - 0.5;
+            int first = int(std::floor(center - radius)) + 1;
+            double sum = 0;
+            for (int t = 0; t < taps; ++t) {
+                double w = std::max(0.0, 1.0 - std::abs(first + t - center) / radius);
+                index[d * taps + t] = CLAMP(first + t, 0, src_size - 1);
+                weight[d * taps + t] = w;
+                sum += w;
+            }
+            for (int t = 0; t < taps; ++t)
+                weight[d * taps + t] /= sum;
+        }
+    }
+};
+
+
+/* horizontal pass of scale_smooth(): filter a source row into four floats per destination pixel. */
+static void smooth_filter_row(guint32 const *src, float *dest, int dw, SmoothFilterAxis const &axis) {
+    int const taps = axis.taps;
+    int const *index = axis.index.data();
+    float const *weight = axis.weight.data();
+#ifdef __SSE2__
+    __m128i const zero = _mm_setzero_si128();
+#endif
+    for (int x = 0; x < dw; ++x, index += taps, weight += taps) {
+#ifdef __SSE2__
+        __m128 sum = _mm_setzero_ps();
+        for (int t = 0; t < taps; ++t) {
+            __m128i bytes = _mm_cvtsi32_si128(src[index[t]]);
+            __m128 channels = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+            sum = _mm_add_ps(sum, _mm_mul_ps(channels, _mm_set1_ps(weight[t])));
+        }
+        _mm_storeu_ps(&dest[x * 4], sum);
+#else
+        float sum[4] = {0, 0, 0, 0};
+        for (int t = 0; t < taps; ++t) {
+            guint8 const *channels = reinterpret_cast<guint8 const *>(&src[index[t]]);
+            for (int c = 0; c < 4; ++c)
+                sum[c] += channels[c] * weight[t];
+        }
+        memcpy(&dest[x * 4], sum, sizeof(sum));
+#endif
+    }
+}
+
+
+/* vertical pass of scale_smooth(): add the weighted, horizontally filtered rows, and convert back to pixels. */
+static void smooth_filter_column(float const *const *rows, float const *weight, int taps, guint32 *dest, int dw) {
+    for (int x = 0; x < dw; ++x) {
+#ifdef __SSE2__
+        __m128 sum = _mm_setzero_ps();
+        for (int t = 0; t < taps; ++t)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&rows[t][x * 4]), _mm_set1_ps(weight[t])));
+        /* round, then saturate to bytes */
+        __m128i channels = _mm_cvtps_epi32(sum);
+        channels = _mm_packs_epi32(channels, channels);
+        dest[x] = _mm_cvtsi128_si32(_mm_packus_epi16(channels, channels));
+#else
+        guint8 *channels = reinterpret_cast<guint8 *>(&dest[x]);
+        for (int c = 0; c < 4; ++c) {
+            float sum = 0;
+            for (int t = 0; t < taps; ++t)
+                sum += rows[t][x * 4 + c] * weight[t];
+            channels[c] = CLAMP(int(std::lrint(sum)), 0, 255);
+        }
+#endif
+    }
+}
+
+
+/* smooth scaling for any factor, with a separable tent filter. the size
+ * of the destination pixbuf decides the factor. the channels of the pixels
+ * are all handled the same way, so the byte order does not matter.
+ * the destination is processed in bands of rows; a band filters the source
+ * rows it needs horizontally into floats, and then combines them vertically.
+ * large images are processed by several threads, band by band. */
+void scale_smooth(const Pixbuf &src, Pixbuf &dest) {
+    int const sw = src.get_width(), sh = src.get_height();
+    int const dw = dest.get_width(), dh = dest.get_height();
+    if (sw == 0 || sh == 0 || dw == 0 || dh == 0)
+        return;
+
+    SmoothFilterAxis const horizontal(sw, dw), vertical(sh, dh);
+
+    gd_parallel_rows(dh, dw, [&](int y1, int y2) {
+        /* the source rows needed by this band */
+        int const taps = vertical.taps;
+        auto band_indexes = std::minmax_element(vertical.index.data() + y1 * taps, vertical.index.data() + y2 * taps);
+        int sy1 = *band_indexes.first, sy2 = *band_indexes.second + 1;
+        std::vector<float> filtered((sy2 - sy1) * dw * 4);
+        for (int sy = sy1; sy < sy2; ++sy)
+            smooth_filter_row(src.get_row(sy), &filtered[(sy - sy1) * dw * 4], dw, horizontal);
+
+        std::vector<float const *> rows(taps);
+        for (int y = y1; y < y2; ++y) {
+            for (int t = 0; t < taps; ++t)
+                rows[t] = &filtered[(vertical.index[y * taps + t] - sy1) * dw * 4];
+            smooth_filter_column(rows.data(), &vertical.weight[y * taps], taps, dest.get_row(y), dw);
+        }
+    });
+}
+
+
 /* pal emulation for 32-bit rgba images. */
 
 /* used:
@@ -192,225 +352,269 @@ void scale3x(const Pixbuf &src, Pixbuf &dest) {
     256*b=u+y
 */
 
-struct YUV {
-    /* we use values *256 here for fixed point math, so 8bits is not enough */
-    gint32 y, u, v;
-};
-
-static void luma_blur(YUV **yuv, YUV **work, int width, int height) {
-    /* convolution "matrices" could be 5 numbers, ie. x-2, x-1, x, x+1, x+2... */
-    /* but the output already has problems for x-1 and x+1. as the game only
-       pal_emus cells, not complete screens - so they are only 3 pixels wide */
-    /* convolution "matrix" for luminance */
-    static const int lconv[] = { 1, 3, 1, }, ldiv = lconv[0] + lconv[1] + lconv[2];
-    /* for left edge of image. */
-    static const int lconv_left[] = { 1, 10, 6, }, ldiv_left = lconv_left[0] + lconv_left[1] + lconv_left[2];
-    /* for right edge of image. */
-    static const int lconv_right[] = { 6, 10, 1, }, ldiv_right = lconv_right[0] + lconv_right[1] + lconv_right[2];
-
-    /* apply convolution matrix */
-    /* luma blur */
-    for (int y = 0; y < height; y++) {
-        YUV n;    /* new value of this pixel in yuv */
-        int x, xm, xp;
-
-        /* for x = 0 (left edge) */
-        xm = width - 1;
-        x = 0;
-        xp = 1;
-        n.y = (yuv[y][xm].y * lconv_left[0] + yuv[y][x].y * lconv_left[1] + yuv[y][xp].y * lconv_left[2]) / ldiv_left;
-        work[y][x].y = n.y;
-
-        /* for x = 1..width-2 */
-        for (int x = 1; x < width - 1; x++) {
-            int xm = x - 1;
-            int xp = x + 1;
-            n.y = (yuv[y][xm].y * lconv[0] + yuv[y][x].y * lconv[1] + yuv[y][xp].y * lconv[2]) / ldiv;
-            work[y][x].y = n.y;
-        }
-
-        /* for x = width-1 (right edge) */
-        xm = width - 2;
-        x = width - 1;
-        xp = 0;
-        n.y = (yuv[y][xm].y * lconv_right[0] + yuv[y][x].y * lconv_right[1] + yuv[y][xp].y * lconv_right[2]) / ldiv_right;
-        work[y][x].y = n.y;
-    }
-
-    for (int y = 0; y < height; y++)
-        for (int x = 0; x < width; x++)
-            yuv[y][x].y = work[y][x].y;
-}
-
-
-static void chroma_blur(YUV **yuv, YUV **work, int width, int height) {
-    /* convolution "matrix" for chrominance */
-    /* x-2, x-1, x, x+1, x+2 */
-    static const int cconv[] = { 1, 1, 1, 1, 1, }, cdiv = cconv[0] + cconv[1] + cconv[2] + cconv[3] + cconv[4];
-
-    /* apply convolution matrix */
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            int xm, xm2, xp, xp2;
-
-            /* turnaround coordinates */
-            xm2 = (x - 2 + width) % width;
-            xm = (x - 1 + width) % width;
-            xp = (x + 1) % width;
-            xp2 = (x + 2) % width;
-
-            /* chroma blur */
-            work[y][x].u = (yuv[y][xm2].u * cconv[0] + yuv[y][xm].u * cconv[1] + yuv[y][x].u * cconv[2] + yuv[y][xp].u * cconv[3] + yuv[y][xp2].u * cconv[4]) / cdiv;
-            work[y][x].v = (yuv[y][xm2].v * cconv[0] + yuv[y][xm].v * cconv[1] + yuv[y][x].v * cconv[2] + yuv[y][xp].v * cconv[3] + yuv[y][xp2].v * cconv[4]) / cdiv;
-        }
-    }
-
-    for (int y = 0; y < height; y++)
-        for (int x = 0; x < width; x++) {
-            yuv[y][x].u = work[y][x].u;
-            yuv[y][x].v = work[y][x].v;
-        }
-}
+/* the filters of the pal emulation are all horizontal, so every row of the image
+ * can be processed on its own. a row is converted to yuv, all filters are run on it,
+ * and then it is converted back, while it is still in the cache. the images are
+ * mostly small cells, but large ones (like the title screen) are split into bands
+ * of rows which are processed by several threads. */
 
 #define CROSSTALK_SIZE 16
 
-static void chroma_crosstalk_to_luma(YUV **yuv, YUV **work, int width, int height) {
-    /* arrays to store things */
-    static int crosstalk_sin[CROSSTALK_SIZE];
-    static int crosstalk_cos[CROSSTALK_SIZE];
+/* the crosstalk tables. calculated once; static initialization is thread safe. */
+struct PalCrosstalk {
     /* crosstalk will be amplitude/div; we use these two to have integer arithmetics */
-    const int crosstalk_amplitude = 384;
-    const int crosstalk_div = 256;
-    static bool crosstalk_calculated = false;
+    enum { amplitude = 384, div = 256 };
+    int sin[CROSSTALK_SIZE];
+    int cos[CROSSTALK_SIZE];
 
-    if (!crosstalk_calculated) {
-        crosstalk_calculated = true;
+    PalCrosstalk() {
         for (int i = 0; i < CROSSTALK_SIZE; i++) {
             double f = (double)i / CROSSTALK_SIZE * 2.0 * G_PI * 2;
-            crosstalk_sin[i] = crosstalk_amplitude * sin(f);
-            crosstalk_cos[i] = crosstalk_amplitude * cos(f);
+            sin[i] = amplitude * ::sin(f);
+            cos[i] = amplitude * ::cos(f);
         }
     }
+};
 
-    /* apply edge detection matrix */
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            const int conv[] = { -1, 1, 0, 0, 0,};
 
-            /* turnaround coordinates */
-            int xm2 = (x - 2 + width) % width;
-            int xm = (x - 1 + width) % width;
-            int xp = (x + 1) % width;
-            int xp2 = (x + 2) % width;
+/* buffers for processing one row of an image, in one contiguous block.
+ * every array has two extra elements on both sides, which hold the pixels
+ * from the other end of the row (the filters wrap around). */
+class PalRowBuffer {
+    int width;
+    std::vector<gint32> memory;
 
-            /* edge detect */
-            work[y][x].u = yuv[y][xm2].u * conv[0] + yuv[y][xm].u * conv[1] + yuv[y][x].u * conv[2] + yuv[y][xp].u * conv[3] + yuv[y][xp2].u * conv[4];
-            work[y][x].v = yuv[y][xm2].v * conv[0] + yuv[y][xm].v * conv[1] + yuv[y][x].v * conv[2] + yuv[y][xp].v * conv[3] + yuv[y][xp2].v * conv[4];
+public:
+    enum { Pad = 2 };
+    /* luma, chroma and alpha as read from the image; then luma and chroma blurred */
+    gint32 *y, *u, *v, *a, *yb, *ub, *vb, *ab;
+
+    explicit PalRowBuffer(int width) : width(width), memory(8 * (width + 2 * Pad)) {
+        gint32 **arrays[] = { &y, &u, &v, &a, &yb, &ub, &vb, &ab };
+        for (unsigned i = 0; i < G_N_ELEMENTS(arrays); ++i)
+            *arrays[i] = &memory[i * (width + 2 * Pad) + Pad];
+    }
+
+    /* fill the extra elements of an array, just like the (x + width) % width turnaround coordinates would */
+    void wrap(gint32 *array) const {
+        for (int i = 1; i <= Pad; ++i) {
+            array[-i] = array[((-i) % width + width) % width];
+            array[width - 1 + i] = array[(width - 1 + i) % width];
         }
     }
+};
 
-    for (int y = 0; y < height; y++)
-        if (y / 2 % 2 == 1) /* rows 3&4 */
-            for (int x = 0; x < width; x++)
-                yuv[y][x].y += (crosstalk_sin[x % CROSSTALK_SIZE] * work[y][x].u - crosstalk_cos[x % CROSSTALK_SIZE] * work[y][x].v) / crosstalk_div; /* odd lines (/2) */
-        else          /* rows 1&2 */
-            for (int x = 0; x < width; x++)
-                yuv[y][x].y += (crosstalk_sin[x % CROSSTALK_SIZE] * work[y][x].u + crosstalk_cos[x % CROSSTALK_SIZE] * work[y][x].v) / crosstalk_div; /* even lines (/2) */
-}
 
-#undef CROSSTALK_SIZE
+#ifdef PAL_EMU_SSE2
+/* the low 32 bits of the products of the lanes, which is the same for signed and unsigned numbers */
+static inline __m128i mullo_epi32(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
 
+/* n / d, rounded towards zero, like the integer division. the result is exact for
+ * the numbers used here: n is below 2^24, so it is exactly representable as a float,
+ * and the quotient is below 2^16, so the rounding error of the division is smaller
+ * than 1/d, and cannot move the quotient over an integer. */
+static inline __m128i div_epi32(__m128i n, __m128 d) {
+    return _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(n), d));
+}
 
-static void scanline_shade(YUV **yuv, YUV **work, int width, int height) {
-    if (gd_pal_emu_scanline_shade < 0)
-        gd_pal_emu_scanline_shade = 0;
-    if (gd_pal_emu_scanline_shade > 100)
-        gd_pal_emu_scanline_shade = 100;
-    int shade = gd_pal_emu_scanline_shade * 256 / 100;
+/* n / 256, rounded towards zero */
+static inline __m128i div256_epi32(__m128i n) {
+    __m128i bias = _mm_and_si128(_mm_srai_epi32(n, 31), _mm_set1_epi32(255));
+    return _mm_srai_epi32(_mm_add_epi32(n, bias), 8);
+}
 
-    /* apply shade for every second row */
-    for (int y = 1; y < height; y += 2)
-        for (int x = 0; x < width; x++)
-            yuv[y][x].y = yuv[y][x].y * shade / 256;
+/* the sums of the neighbouring 32-bit lane pairs of two vectors, a0+a1, a2+a3, b0+b1, b2+b3 */
+static inline __m128i add_pairs_epi32(__m128i a, __m128i b) {
+    __m128 af = _mm_castsi128_ps(a), bf = _mm_castsi128_ps(b);
+    __m128i even = _mm_castps_si128(_mm_shuffle_ps(af, bf, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i odd = _mm_castps_si128(_mm_shuffle_ps(af, bf, _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm_add_epi32(even, odd);
+}
+#endif
+
+
+/* luma blur, also used for the alpha channel. */
+/* convolution "matrices" could be 5 numbers, ie. x-2, x-1, x, x+1, x+2... */
+/* but the output already has problems for x-1 and x+1. as the game only
+   pal_emus cells, not complete screens - so they are only 3 pixels wide */
+static void luma_blur_row(gint32 const *__restrict in, gint32 *__restrict out, int width) {
+    /* left edge of image, the convolution "matrix" is 1, 10, 6 */
+    out[0] = (in[-1] * 1 + in[0] * 10 + in[1] * 6) / 17;
+    /* for x = 1..width-2, 1, 3, 1 */
+    int x = 1;
+#ifdef PAL_EMU_SSE2
+    __m128 const five = _mm_set1_ps(5);
+    for (; x + 4 <= width - 1; x += 4) {
+        __m128i c = _mm_loadu_si128((__m128i const *) &in[x]);
+        __m128i sum = _mm_add_epi32(_mm_loadu_si128((__m128i const *) &in[x - 1]), _mm_loadu_si128((__m128i const *) &in[x + 1]));
+        sum = _mm_add_epi32(sum, _mm_add_epi32(c, _mm_slli_epi32(c, 1)));
+        _mm_storeu_si128((__m128i *) &out[x], div_epi32(sum, five));
+    }
+#endif
+    for (; x < width - 1; x++)
+        out[x] = (in[x - 1] + in[x] * 3 + in[x + 1]) / 5;
+    /* right edge of image, 6, 10, 1 */
+    out[width - 1] = (in[width - 2] * 6 + in[width - 1] * 10 + in[width] * 1) / 17;
 }
 
 
-static inline int clamp(int value, int min, int max) {
-    if (value < min)
-        return min;
-    if (value > max)
-        return max;
-    return value;
+/* chroma blur, the convolution "matrix" is 1, 1, 1, 1, 1 */
+static void chroma_blur_row(gint32 const *__restrict in, gint32 *__restrict out, int width) {
+    int x = 0;
+#ifdef PAL_EMU_SSE2
+    __m128 const five = _mm_set1_ps(5);
+    for (; x + 4 <= width; x += 4) {
+        __m128i sum = _mm_add_epi32(_mm_loadu_si128((__m128i const *) &in[x - 2]), _mm_loadu_si128((__m128i const *) &in[x - 1]));
+        sum = _mm_add_epi32(sum, _mm_loadu_si128((__m128i const *) &in[x]));
+        sum = _mm_add_epi32(sum, _mm_add_epi32(_mm_loadu_si128((__m128i const *) &in[x + 1]), _mm_loadu_si128((__m128i const *) &in[x + 2])));
+        _mm_storeu_si128((__m128i *) &out[x], div_epi32(sum, five));
+    }
+#endif
+    for (; x < width; x++)
+        out[x] = (in[x - 2] + in[x - 1] + in[x] + in[x + 1] + in[x + 2]) / 5;
 }
 
-void pal_emulate(Pixbuf &pb) {
-    int width = pb.get_width();
-    int height = pb.get_height();
-
-    /* memory for yuv images */
-    YUV **yuv = new YUV*[height];
-    for (int y = 0; y < height; y++)
-        yuv[y] = new YUV[width];
-    YUV **work = new YUV*[height];
-    for (int y = 0; y < height; y++)
-        work[y] = new YUV[width];
-    YUV **alpha = new YUV*[height]; /* alpha is not really yuv, only y will be used. luma blur touches only y. */
-    for (int y = 0; y < height; y++)
-        alpha[y] = new YUV[width];
 
+/* run the pal emulation on a row of pixels.
+ * @param row the pixels.
+ * @param y the row number in the image; it decides the crosstalk phase and the scanline shading.
+ * @param shade the shading of every second scanline, 256 = no shading. */
+static void pal_emulate_row(guint32 *row, int width, int y, int shade, PalRowBuffer &buf, PalCrosstalk const &crosstalk) {
     /* convert to yuv */
-    for (int y = 0; y < height; y++) {
-        guint32 *row = pb.get_row(y);
-
-        for (int x = 0; x < width; x++) {
-            int r = (row[x] >> pb.rshift) & 0xff;
-            int g = (row[x] >> pb.gshift) & 0xff;
-            int b = (row[x] >> pb.bshift) & 0xff;
-
-            /* now y, u, v will contain values * 256 */
-            yuv[y][x].y = 77 * r + 150 * g + 29 * b; /* always pos */
-            yuv[y][x].u = -37 * r - 74 * g + 111 * b; /* pos or neg */
-            yuv[y][x].v = 157 * r - 131 * g - 26 * b; /* pos or neg */
+    int x = 0;
+#ifdef PAL_EMU_SSE2
+    /* the 16-bit components of two pixels are multiplied and added in pairs: r*cr+g*cg and b*cb+a*0 */
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const y_coeffs = _mm_setr_epi16(77, 150, 29, 0, 77, 150, 29, 0);
+    __m128i const u_coeffs = _mm_setr_epi16(-37, -74, 111, 0, -37, -74, 111, 0);
+    __m128i const v_coeffs = _mm_setr_epi16(157, -131, -26, 0, 157, -131, -26, 0);
+    for (; x + 4 <= width; x += 4) {
+        __m128i pixels = _mm_loadu_si128((__m128i const *) &row[x]);
+        __m128i lo = _mm_unpacklo_epi8(pixels, zero), hi = _mm_unpackhi_epi8(pixels, zero);
+        _mm_storeu_si128((__m128i *) &buf.y[x], add_pairs_epi32(_mm_madd_epi16(lo, y_coeffs), _mm_madd_epi16(hi, y_coeffs)));
+        _mm_storeu_si128((__m128i *) &buf.u[x], add_pairs_epi32(_mm_madd_epi16(lo, u_coeffs), _mm_madd_epi16(hi, u_coeffs)));
+        _mm_storeu_si128((__m128i *) &buf.v[x], add_pairs_epi32(_mm_madd_epi16(lo, v_coeffs), _mm_madd_epi16(hi, v_coeffs)));
+        _mm_storeu_si128((__m128i *) &buf.a[x], _mm_srli_epi32(pixels, Pixbuf::ashift));
+    }
+#endif
+    for (; x < width; x++) {
+        int r = (row[x] >> Pixbuf::rshift) & 0xff;
+        int g = (row[x] >> Pixbuf::gshift) & 0xff;
+        int b = (row[x] >> Pixbuf::bshift) & 0xff;
+
+        /* now y, u, v will contain values * 256 */
+        buf.y[x] = 77 * r + 150 * g + 29 * b; /* always pos */
+        buf.u[x] = -37 * r - 74 * g + 111 * b; /* pos or neg */
+        buf.v[x] = 157 * r - 131 * g - 26 * b; /* pos or neg */
+        /* alpha is copied as is, and is not *256 */
+        buf.a[x] = (row[x] >> Pixbuf::ashift) & 0xff;
+    }
+    buf.wrap(buf.y);
+    buf.wrap(buf.u);
+    buf.wrap(buf.v);
+    buf.wrap(buf.a);
+
+    luma_blur_row(buf.y, buf.yb, width);
+    luma_blur_row(buf.a, buf.ab, width);
+    chroma_blur_row(buf.u, buf.ub, width);
+    chroma_blur_row(buf.v, buf.vb, width);
+    buf.wrap(buf.ub);
+    buf.wrap(buf.vb);
+
+    /* chroma crosstalk to luma. the edge detection "matrix" for chroma is -1, 1, 0, 0, 0.
+     * rows 1&2 add the cos part, rows 3&4 subtract it. */
+    int const cos_sign = (y / 2 % 2 == 1) ? -1 : 1;
+    gint32 *__restrict yb = buf.yb;
+    gint32 const *__restrict ub = buf.ub, *__restrict vb = buf.vb;
+    x = 0;
+#ifdef PAL_EMU_SSE2
+    __m128i const cos_sign_vec = _mm_set1_epi32(cos_sign);
+    for (; x + 4 <= width; x += 4) {
+        /* x is a multiple of 4, so the four table entries are next to each other */
+        __m128i sin = _mm_loadu_si128((__m128i const *) &crosstalk.sin[x % CROSSTALK_SIZE]);
+        __m128i cos = mullo_epi32(_mm_loadu_si128((__m128i const *) &crosstalk.cos[x % CROSSTALK_SIZE]), cos_sign_vec);
+        __m128i edge_u = _mm_sub_epi32(_mm_loadu_si128((__m128i const *) &ub[x - 1]), _mm_loadu_si128((__m128i const *) &ub[x - 2]));
+        __m128i edge_v = _mm_sub_epi32(_mm_loadu_si128((__m128i const *) &vb[x - 1]), _mm_loadu_si128((__m128i const *) &vb[x - 2]));
+        __m128i talk = div256_epi32(_mm_add_epi32(mullo_epi32(sin, edge_u), mullo_epi32(cos, edge_v)));
+        _mm_storeu_si128((__m128i *) &yb[x], _mm_add_epi32(_mm_loadu_si128((__m128i const *) &yb[x]), talk));
+    }
+#endif
+    for (; x < width; x++) {
+        gint32 edge_u = ub[x - 1] - ub[x - 2];
+        gint32 edge_v = vb[x - 1] - vb[x - 2];
+        yb[x] += (crosstalk.sin[x % CROSSTALK_SIZE] * edge_u + cos_sign * crosstalk.cos[x % CROSSTALK_SIZE] * edge_v) / PalCrosstalk::div;
+    }
 
-            /* alpha is copied as is, and is not *256 */
-            alpha[y][x].y = (row[x] >> pb.ashift) & 0xff;
+    /* shade every second row */
+    if (y % 2 == 1) {
+        x = 0;
+#ifdef PAL_EMU_SSE2
+        __m128i const shade_vec = _mm_set1_epi32(shade);
+        for (; x + 4 <= width; x += 4) {
+            __m128i shaded = div256_epi32(mullo_epi32(_mm_loadu_si128((__m128i const *) &yb[x]), shade_vec));
+            _mm_storeu_si128((__m128i *) &yb[x], shaded);
         }
+#endif
+        for (; x < width; x++)
+            yb[x] = yb[x] * shade / 256;
     }
 
-    /* we give them an array to "work" in, so that is not free()d and malloc() four times */
-    luma_blur(yuv, work, width, height);
-    chroma_blur(yuv, work, width, height);
-    chroma_crosstalk_to_luma(yuv, work, width, height);
-    scanline_shade(yuv, work, width, height);
-
-    luma_blur(alpha, work, width, height);
-
     /* convert back to rgb */
-    for (int y = 0; y < height; y++) {
-        guint32 *row = pb.get_row(y);
-
-        for (int x = 0; x < width; x++) {
-            /* back to rgb */
-            int r = clamp((256 * yuv[y][x].y                + 292 * yuv[y][x].v + 32768) / 65536, 0, 255);
-            int g = clamp((256 * yuv[y][x].y - 101 * yuv[y][x].u - 149 * yuv[y][x].v + 32768) / 65536, 0, 255);
-            int b = clamp((256 * yuv[y][x].y + 519 * yuv[y][x].u                + 32768) / 65536, 0, 255);
+    x = 0;
+#ifdef PAL_EMU_SSE2
+    /* the division rounds down here, not towards zero; that only makes a difference
+     * for negative values, which become zero anyway. the packing instructions do the clamping. */
+    __m128i const round = _mm_set1_epi32(32768);
+    __m128i const c292 = _mm_set1_epi32(292), c101 = _mm_set1_epi32(101), c149 = _mm_set1_epi32(149), c519 = _mm_set1_epi32(519);
+    for (; x + 4 <= width; x += 4) {
+        __m128i y256 = _mm_add_epi32(_mm_slli_epi32(_mm_loadu_si128((__m128i const *) &yb[x]), 8), round);
+        __m128i u = _mm_loadu_si128((__m128i const *) &ub[x]);
+        __m128i v = _mm_loadu_si128((__m128i const *) &vb[x]);
+        __m128i r = _mm_srai_epi32(_mm_add_epi32(y256, mullo_epi32(v, c292)), 16);
+        __m128i g = _mm_srai_epi32(_mm_sub_epi32(y256, _mm_add_epi32(mullo_epi32(u, c101), mullo_epi32(v, c149))), 16);
+        __m128i b = _mm_srai_epi32(_mm_add_epi32(y256, mullo_epi32(u, c519)), 16);
+        __m128i a = _mm_loadu_si128((__m128i const *) &buf.ab[x]);
+        /* r0-3 b0-3 g0-3 a0-3 as bytes, then interleaved to rgba pixels */
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(r, b), _mm_packs_epi32(g, a));
+        __m128i rgbg = _mm_unpacklo_epi8(bytes, _mm_srli_si128(bytes, 8));
+        __m128i pixels = _mm_unpacklo_epi16(rgbg, _mm_srli_si128(rgbg, 8));
+        _mm_storeu_si128((__m128i *) &row[x], pixels);
+    }
+#endif
+    for (; x < width; x++) {
+        int r = CLAMP((256 * yb[x]               + 292 * vb[x] + 32768) / 65536, 0, 255);
+        int g = CLAMP((256 * yb[x] - 101 * ub[x] - 149 * vb[x] + 32768) / 65536, 0, 255);
+        int b = CLAMP((256 * yb[x] + 519 * ub[x]               + 32768) / 65536, 0, 255);
+
+        /* alpha channel is preserved, others are converted back from yuv */
+        row[x] = (buf.ab[x] << Pixbuf::ashift) | (r << Pixbuf::rshift) | (g << Pixbuf::gshift) | (b << Pixbuf::bshift);
+    }
+}
 
-            /* alpha channel is preserved, others are converted back from yuv */
-            row[x] = (alpha[y][x].y << pb.ashift) | (r << pb.rshift) | (g << pb.gshift) | (b << pb.bshift);
-        }
+#undef CROSSTALK_SIZE
+#undef PAL_EMU_SSE2
 
-    }
 
-    /* free arrays */
-    for (int y = 0; y < height; y++)
-        delete[] yuv[y];
-    delete[] yuv;
-    for (int y = 0; y < height; y++)
-        delete[] alpha[y];
-    delete[] alpha;
-    for (int y = 0; y < height; y++)
-        delete[] work[y];
-    delete[] work;
+void pal_emulate(Pixbuf &pb) {
+    int width = pb.get_width();
+    int height = pb.get_height();
+    if (width == 0 || height == 0)
+        return;
+
+    /* may run on several threads at once (see prepare_cells), so the setting is not modified */
+    int shade_pct = CLAMP(gd_pal_emu_scanline_shade, 0, 100);
+    int shade = shade_pct * 256 / 100;
+    static PalCrosstalk const crosstalk;
+
+    gd_parallel_rows(height, width, [&](int y1, int y2) {
+        PalRowBuffer buf(width);
+        for (int y = y1; y < y2; y++)
+            pal_emulate_row(pb.get_row(y), width, y, shade, buf, crosstalk);
+    });
 }
 
 
@@ -34,6 +34,8 @@ void scale2x(const Pixbuf &src, Pixbuf &dest);
 void scale3x(const Pixbuf &src, Pixbuf &dest);
 void scale2xnearest(const Pixbuf &src, Pixbuf &dest);
 void scale3xnearest(const Pixbuf &src, Pixbuf &dest);
+void scale_nearest(const Pixbuf &src, Pixbuf &dest);
+void scale_smooth(const Pixbuf &src, Pixbuf &dest);
 void pal_emulate(Pixbuf &pb);
 void hq2x(Pixbuf const &src, Pixbuf &dst);
 void hq3x(Pixbuf const &src, Pixbuf &dst);
@@ -32,6 +32,8 @@
  *
  * The RGBtoYUV lookup table is removed, as scaling is only done once
  * in GDash for every cave loading, not continuously during the game.
+ * Instead, the yuv values and the pattern codes of the source pixels are
+ * calculated once for the whole image by HqxSource.
  *
  * The interpolation functions are changed so they do not produce
  * overflows for the most significant bytes. So when calculating, they
@@ -44,6 +46,7 @@
 
 #include "gfx/pixbufmanip.hpp"
 #include "gfx/pixbufmanip_hqx.hpp"
+#include "misc/threadpool.hpp"
 
 #define PIXEL00_0     *dp = w[5];
 #define PIXEL00_10    Interp1(dp, w[5], w[1]);
@@ -94,8 +97,9 @@
 #define PIXEL11_90    Interp9(dp+dpL+1, w[5], w[6], w[8]);
 #define PIXEL11_100   Interp10(dp+dpL+1, w[5], w[6], w[8]);
 
-void hq2x(Pixbuf const &src, Pixbuf &dst) {
+static void hq2x_rows(HqxSource const &source, Pixbuf &dst, int first, int last) {
     guint32  w[10];
+    guint32  yuv[10];
 
     //   +----+----+----+
     //   |    |    |    |
@@ -108,60 +112,37 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
     //   | w7 | w8 | w9 |
     //   +----+----+----+
 
-    int sw = src.get_width();
-    int sh = src.get_height();
+    int sw = source.get_width();
     int dpL = dst.get_pitch() / 4; /* 4 bytes/pixel */
 
-    for (int j = 0; j < sh; j++) {
-        const guint32 *line = src.get_row(j);
-        const guint32 *prevline, *nextline;
-        if (j > 0)      prevline = src.get_row(j - 1);
-        else prevline = src.get_row(sh - 1);
-        if (j < sh - 1)   nextline = src.get_row(j + 1);
-        else nextline = src.get_row(0);
+    for (int j = first; j < last; j++) {
+        const guint32 *prevline = source.rgb_row(j - 1);
+        const guint32 *line = source.rgb_row(j);
+        const guint32 *nextline = source.rgb_row(j + 1);
+        const guint32 *prevyuv = source.yuv_row(j - 1);
+        const guint32 *lineyuv = source.yuv_row(j);
+        const guint32 *nextyuv = source.yuv_row(j + 1);
+        const guint8 *patterns = source.pattern_row(j);
 
         for (int i = 0; i < sw; i++) {
+            /* the borders of the rows hold the wrapped around pixels */
+            w[1] = prevline[i - 1];
             w[2] = prevline[i];
+            w[3] = prevline[i + 1];
+            w[4] = line[i - 1];
             w[5] = line[i];
+            w[6] = line[i + 1];
+            w[7] = nextline[i - 1];
             w[8] = nextline[i];
+            w[9] = nextline[i + 1];
 
-            if (i > 0) {
-                w[1] = prevline[i - 1];
-                w[4] = line[i - 1];
-                w[7] = nextline[i - 1];
-            } else {
-                w[1] = prevline[sw - 1];
-                w[4] = line[sw - 1];
-                w[7] = nextline[sw - 1];
-            }
-
-            if (i < sw - 1) {
-                w[3] = prevline[i + 1];
-                w[6] = line[i + 1];
-                w[9] = nextline[i + 1];
-            } else {
-                w[3] = prevline[0];
-                w[6] = line[0];
-                w[9] = nextline[0];
-            }
-
-            int pattern = 0;
-            int flag = 1;
-
-            guint32 YUV1 = RGBtoYUV(w[5]);
+            /* the case tables only compare the edge neighbours to each other */
+            yuv[2] = prevyuv[i];
+            yuv[4] = lineyuv[i - 1];
+            yuv[6] = lineyuv[i + 1];
+            yuv[8] = nextyuv[i];
 
-            for (int k = 1; k <= 9; k++) {
-                if (k == 5) continue;
-
-                if (w[k] != w[5]) {
-                    guint32 YUV2 = RGBtoYUV(w[k]);
-                    if ((abs(gint32(YUV1 & Ymask) - gint32(YUV2 & Ymask)) > trY) ||
-                            (abs(gint32(YUV1 & Umask) - gint32(YUV2 & Umask)) > trU) ||
-                            (abs(gint32(YUV1 & Vmask) - gint32(YUV2 & Vmask)) > trV))
-                        pattern |= flag;
-                }
-                flag <<= 1;
-            }
+            int pattern = patterns[i];
 
             guint32 *dp = dst.get_row(j * 2) + i * 2;
 
@@ -311,7 +292,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 18:
                 case 50: {
                     PIXEL00_22
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_20
@@ -325,7 +306,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL00_20
                     PIXEL01_22
                     PIXEL10_21
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_20
@@ -336,7 +317,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 76: {
                     PIXEL00_21
                     PIXEL01_20
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_20
@@ -346,7 +327,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 10:
                 case 138: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_20
@@ -409,7 +390,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 22:
                 case 54: {
                     PIXEL00_22
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
@@ -423,7 +404,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL00_20
                     PIXEL01_22
                     PIXEL10_21
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -434,7 +415,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 108: {
                     PIXEL00_21
                     PIXEL01_20
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
@@ -444,7 +425,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 11:
                 case 139: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
@@ -456,7 +437,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 19:
                 case 51: {
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL00_11
                         PIXEL01_10
                     } else {
@@ -470,7 +451,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 146:
                 case 178: {
                     PIXEL00_22
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                         PIXEL11_12
                     } else {
@@ -483,7 +464,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 84:
                 case 85: {
                     PIXEL00_20
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL01_11
                         PIXEL11_10
                     } else {
@@ -497,7 +478,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 113: {
                     PIXEL00_20
                     PIXEL01_22
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL10_12
                         PIXEL11_10
                     } else {
@@ -510,7 +491,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 204: {
                     PIXEL00_21
                     PIXEL01_20
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                         PIXEL11_11
                     } else {
@@ -521,7 +502,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 73:
                 case 77: {
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL00_12
                         PIXEL10_10
                     } else {
@@ -534,7 +515,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 42:
                 case 170: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                         PIXEL10_11
                     } else {
@@ -547,7 +528,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 14:
                 case 142: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                         PIXEL01_12
                     } else {
@@ -616,12 +597,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 26:
                 case 31: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
@@ -633,13 +614,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 82:
                 case 214: {
                     PIXEL00_22
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
                     }
                     PIXEL10_21
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -650,12 +631,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 248: {
                     PIXEL00_21
                     PIXEL01_22
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -664,13 +645,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 74:
                 case 107: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
                     }
                     PIXEL01_21
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
@@ -679,7 +660,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 27: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
@@ -691,7 +672,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 86: {
                     PIXEL00_22
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
@@ -704,7 +685,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL00_21
                     PIXEL01_22
                     PIXEL10_10
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -714,7 +695,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 106: {
                     PIXEL00_10
                     PIXEL01_21
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
@@ -724,7 +705,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 30: {
                     PIXEL00_10
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
@@ -737,7 +718,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL00_22
                     PIXEL01_10
                     PIXEL10_21
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -747,7 +728,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 120: {
                     PIXEL00_21
                     PIXEL01_22
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
@@ -756,7 +737,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 75: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
@@ -851,12 +832,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 58: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_70
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_70
@@ -867,13 +848,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 83: {
                     PIXEL00_11
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_70
                     }
                     PIXEL10_21
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_70
@@ -883,12 +864,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 92: {
                     PIXEL00_21
                     PIXEL01_11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_70
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_70
@@ -896,13 +877,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 202: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_70
                     }
                     PIXEL01_21
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_70
@@ -911,13 +892,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 78: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_70
                     }
                     PIXEL01_12
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_70
@@ -926,12 +907,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 154: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_70
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_70
@@ -942,13 +923,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 114: {
                     PIXEL00_22
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_70
                     }
                     PIXEL10_12
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_70
@@ -958,12 +939,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 89: {
                     PIXEL00_12
                     PIXEL01_22
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_70
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_70
@@ -971,22 +952,22 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 90: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_70
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_70
                     }
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_70
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_70
@@ -995,7 +976,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 55:
                 case 23: {
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL00_11
                         PIXEL01_0
                     } else {
@@ -1009,7 +990,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 182:
                 case 150: {
                     PIXEL00_22
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                         PIXEL11_12
                     } else {
@@ -1022,7 +1003,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 213:
                 case 212: {
                     PIXEL00_20
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL01_11
                         PIXEL11_0
                     } else {
@@ -1036,7 +1017,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 240: {
                     PIXEL00_20
                     PIXEL01_22
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL10_12
                         PIXEL11_0
                     } else {
@@ -1049,7 +1030,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 232: {
                     PIXEL00_21
                     PIXEL01_20
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                         PIXEL11_11
                     } else {
@@ -1060,7 +1041,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 109:
                 case 105: {
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL00_12
                         PIXEL10_0
                     } else {
@@ -1073,7 +1054,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 171:
                 case 43: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                         PIXEL10_11
                     } else {
@@ -1086,7 +1067,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 143:
                 case 15: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                         PIXEL01_12
                     } else {
@@ -1100,7 +1081,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 124: {
                     PIXEL00_21
                     PIXEL01_11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
@@ -1109,7 +1090,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 203: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
@@ -1121,7 +1102,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 62: {
                     PIXEL00_10
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
@@ -1134,7 +1115,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL00_11
                     PIXEL01_10
                     PIXEL10_21
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -1143,7 +1124,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 118: {
                     PIXEL00_22
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
@@ -1156,7 +1137,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL00_12
                     PIXEL01_22
                     PIXEL10_10
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -1166,7 +1147,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 110: {
                     PIXEL00_10
                     PIXEL01_12
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
@@ -1175,7 +1156,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 155: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
@@ -1244,12 +1225,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 220: {
                     PIXEL00_21
                     PIXEL01_11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_70
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -1257,12 +1238,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 158: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_70
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
@@ -1272,13 +1253,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 234: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_70
                     }
                     PIXEL01_21
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
@@ -1288,13 +1269,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 242: {
                     PIXEL00_22
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_70
                     }
                     PIXEL10_12
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -1302,12 +1283,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 59: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_70
@@ -1319,12 +1300,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 121: {
                     PIXEL00_12
                     PIXEL01_22
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_70
@@ -1333,13 +1314,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 87: {
                     PIXEL00_11
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
                     }
                     PIXEL10_21
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_70
@@ -1347,13 +1328,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 79: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
                     }
                     PIXEL01_12
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_70
@@ -1362,22 +1343,22 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 122: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_70
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_70
                     }
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_70
@@ -1385,22 +1366,22 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 94: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_70
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
                     }
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_70
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_70
@@ -1408,22 +1389,22 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 218: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_70
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_70
                     }
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_70
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -1431,22 +1412,22 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 91: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_70
                     }
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_70
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_70
@@ -1482,12 +1463,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 186: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_70
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_70
@@ -1498,13 +1479,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 115: {
                     PIXEL00_11
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_70
                     }
                     PIXEL10_12
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_70
@@ -1514,12 +1495,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 93: {
                     PIXEL00_12
                     PIXEL01_11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_70
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_70
@@ -1527,13 +1508,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 206: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_70
                     }
                     PIXEL01_12
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_70
@@ -1545,7 +1526,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 201: {
                     PIXEL00_12
                     PIXEL01_20
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_10
                     } else {
                         PIXEL10_70
@@ -1555,7 +1536,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 174:
                 case 46: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_10
                     } else {
                         PIXEL00_70
@@ -1568,7 +1549,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 179:
                 case 147: {
                     PIXEL00_11
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_10
                     } else {
                         PIXEL01_70
@@ -1582,7 +1563,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL00_20
                     PIXEL01_11
                     PIXEL10_12
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_10
                     } else {
                         PIXEL11_70
@@ -1605,12 +1586,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 126: {
                     PIXEL00_10
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
                     }
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
@@ -1619,14 +1600,14 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 219: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
                     }
                     PIXEL01_10
                     PIXEL10_10
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -1634,7 +1615,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 125: {
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL00_12
                         PIXEL10_0
                     } else {
@@ -1647,7 +1628,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 221: {
                     PIXEL00_12
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL01_11
                         PIXEL11_0
                     } else {
@@ -1658,7 +1639,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 207: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                         PIXEL01_12
                     } else {
@@ -1672,7 +1653,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 238: {
                     PIXEL00_10
                     PIXEL01_12
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                         PIXEL11_11
                     } else {
@@ -1683,7 +1664,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 190: {
                     PIXEL00_10
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                         PIXEL11_12
                     } else {
@@ -1694,7 +1675,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 187: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                         PIXEL10_11
                     } else {
@@ -1708,7 +1689,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 243: {
                     PIXEL00_11
                     PIXEL01_10
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL10_12
                         PIXEL11_0
                     } else {
@@ -1718,7 +1699,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 119: {
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL00_11
                         PIXEL01_0
                     } else {
@@ -1733,7 +1714,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 233: {
                     PIXEL00_12
                     PIXEL01_20
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_100
@@ -1743,7 +1724,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 175:
                 case 47: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_100
@@ -1756,7 +1737,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 183:
                 case 151: {
                     PIXEL00_11
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_100
@@ -1770,7 +1751,7 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL00_20
                     PIXEL01_11
                     PIXEL10_12
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_100
@@ -1780,12 +1761,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 250: {
                     PIXEL00_10
                     PIXEL01_10
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -1793,13 +1774,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 123: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
                     }
                     PIXEL01_10
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
@@ -1808,12 +1789,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 95: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
@@ -1824,13 +1805,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 222: {
                     PIXEL00_10
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
                     }
                     PIXEL10_10
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -1840,12 +1821,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 252: {
                     PIXEL00_21
                     PIXEL01_11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_100
@@ -1855,12 +1836,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 249: {
                     PIXEL00_12
                     PIXEL01_22
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_100
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -1868,13 +1849,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 235: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
                     }
                     PIXEL01_21
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_100
@@ -1883,13 +1864,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 111: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_100
                     }
                     PIXEL01_12
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
@@ -1898,12 +1879,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 63: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_100
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
@@ -1913,12 +1894,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 159: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_100
@@ -1929,13 +1910,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 215: {
                     PIXEL00_11
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_100
                     }
                     PIXEL10_21
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -1944,13 +1925,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 246: {
                     PIXEL00_22
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
                     }
                     PIXEL10_12
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_100
@@ -1959,17 +1940,17 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 254: {
                     PIXEL00_10
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
                     }
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_100
@@ -1979,12 +1960,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 case 253: {
                     PIXEL00_12
                     PIXEL01_11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_100
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_100
@@ -1992,18 +1973,18 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 251: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
                     }
                     PIXEL01_10
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_100
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -2011,13 +1992,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 239: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_100
                     }
                     PIXEL01_12
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_100
@@ -2026,17 +2007,17 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 127: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_100
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_20
                     }
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_20
@@ -2045,12 +2026,12 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 191: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_100
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_100
@@ -2060,18 +2041,18 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 223: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_20
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_100
                     }
                     PIXEL10_10
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_20
@@ -2080,13 +2061,13 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 247: {
                     PIXEL00_11
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_100
                     }
                     PIXEL10_12
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_100
@@ -2094,22 +2075,22 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 255: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_0
                     } else {
                         PIXEL00_100
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_0
                     } else {
                         PIXEL01_100
                     }
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_0
                     } else {
                         PIXEL10_100
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL11_0
                     } else {
                         PIXEL11_100
@@ -2120,3 +2101,11 @@ void hq2x(Pixbuf const &src, Pixbuf &dst) {
         }
     }
 }
+
+
+void hq2x(Pixbuf const &src, Pixbuf &dst) {
+    HqxSource source(src);
+    gd_parallel_rows(source.get_height(), dst.get_width() * 2, [&](int first, int last) {
+        hq2x_rows(source, dst, first, last);
+    });
+}
@@ -32,6 +32,8 @@
  *
  * The RGBtoYUV lookup table is removed, as scaling is only done once
  * in GDash for every cave loading, not continuously during the game.
+ * Instead, the yuv values and the pattern codes of the source pixels are
+ * calculated once for the whole image by HqxSource.
  *
  * The interpolation functions are changed so they do not produce
  * overflows for the most significant bytes. So when calculating, they
@@ -44,6 +46,7 @@
 
 #include "gfx/pixbufmanip.hpp"
 #include "gfx/pixbufmanip_hqx.hpp"
+#include "misc/threadpool.hpp"
 
 #define PIXEL00_1M  Interp1(dp, w[5], w[1]);
 #define PIXEL00_1U  Interp1(dp, w[5], w[2]);
@@ -99,8 +102,9 @@
 #define PIXEL22_5   Interp5(dp+dpL+dpL+2, w[6], w[8]);
 #define PIXEL22_C   *(dp+dpL+dpL+2) = w[5];
 
-void hq3x(Pixbuf const &src, Pixbuf &dst) {
+static void hq3x_rows(HqxSource const &source, Pixbuf &dst, int first, int last) {
     guint32  w[10];
+    guint32  yuv[10];
 
     //   +----+----+----+
     //   |    |    |    |
@@ -113,60 +117,37 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
     //   | w7 | w8 | w9 |
     //   +----+----+----+
 
-    int sw = src.get_width();
-    int sh = src.get_height();
+    int sw = source.get_width();
     int dpL = dst.get_pitch() / 4; /* 4 bytes/pixel */
 
-    for (int j = 0; j < sh; j++) {
-        const guint32 *line = src.get_row(j);
-        const guint32 *prevline, *nextline;
-        if (j > 0)      prevline = src.get_row(j - 1);
-        else prevline = src.get_row(sh - 1);
-        if (j < sh - 1)   nextline = src.get_row(j + 1);
-        else nextline = src.get_row(0);
+    for (int j = first; j < last; j++) {
+        const guint32 *prevline = source.rgb_row(j - 1);
+        const guint32 *line = source.rgb_row(j);
+        const guint32 *nextline = source.rgb_row(j + 1);
+        const guint32 *prevyuv = source.yuv_row(j - 1);
+        const guint32 *lineyuv = source.yuv_row(j);
+        const guint32 *nextyuv = source.yuv_row(j + 1);
+        const guint8 *patterns = source.pattern_row(j);
 
         for (int i = 0; i < sw; i++) {
+            /* the borders of the rows hold the wrapped around pixels */
+            w[1] = prevline[i - 1];
             w[2] = prevline[i];
+            w[3] = prevline[i + 1];
+            w[4] = line[i - 1];
             w[5] = line[i];
+            w[6] = line[i + 1];
+            w[7] = nextline[i - 1];
             w[8] = nextline[i];
+            w[9] = nextline[i + 1];
 
-            if (i > 0) {
-                w[1] = prevline[i - 1];
-                w[4] = line[i - 1];
-                w[7] = nextline[i - 1];
-            } else {
-                w[1] = prevline[sw - 1];
-                w[4] = line[sw - 1];
-                w[7] = nextline[sw - 1];
-            }
-
-            if (i < sw - 1) {
-                w[3] = prevline[i + 1];
-                w[6] = line[i + 1];
-                w[9] = nextline[i + 1];
-            } else {
-                w[3] = prevline[0];
-                w[6] = line[0];
-                w[9] = nextline[0];
-            }
-
-            int pattern = 0;
-            int flag = 1;
-
-            guint32 YUV1 = RGBtoYUV(w[5]);
+            /* the case tables only compare the edge neighbours to each other */
+            yuv[2] = prevyuv[i];
+            yuv[4] = lineyuv[i - 1];
+            yuv[6] = lineyuv[i + 1];
+            yuv[8] = nextyuv[i];
 
-            for (int k = 1; k <= 9; k++) {
-                if (k == 5) continue;
-
-                if (w[k] != w[5]) {
-                    guint32 YUV2 = RGBtoYUV(w[k]);
-                    if ((abs(gint32(YUV1 & Ymask) - gint32(YUV2 & Ymask)) > trY) ||
-                            (abs(gint32(YUV1 & Umask) - gint32(YUV2 & Umask)) > trU) ||
-                            (abs(gint32(YUV1 & Vmask) - gint32(YUV2 & Vmask)) > trV))
-                        pattern |= flag;
-                }
-                flag <<= 1;
-            }
+            int pattern = patterns[i];
 
             guint32 *dp = dst.get_row(j * 3) + i * 3;
 
@@ -381,7 +362,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 case 18:
                 case 50: {
                     PIXEL00_1M
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_1M
                         PIXEL12_C
@@ -405,7 +386,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_1
                     PIXEL11
                     PIXEL20_1M
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL21_C
                         PIXEL22_1M
@@ -423,7 +404,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL02_2
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_1M
                         PIXEL21_C
@@ -437,7 +418,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 10:
                 case 138: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                         PIXEL01_C
                         PIXEL10_C
@@ -537,7 +518,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 case 22:
                 case 54: {
                     PIXEL00_1M
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                         PIXEL12_C
@@ -561,7 +542,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_1
                     PIXEL11
                     PIXEL20_1M
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL21_C
                         PIXEL22_C
@@ -579,7 +560,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL02_2
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                         PIXEL21_C
@@ -593,7 +574,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 11:
                 case 139: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL10_C
@@ -612,7 +593,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 19:
                 case 51: {
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL00_1L
                         PIXEL01_C
                         PIXEL02_1M
@@ -632,7 +613,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 146:
                 case 178: {
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_1M
                         PIXEL12_C
@@ -652,7 +633,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 84:
                 case 85: {
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL02_1U
                         PIXEL12_C
                         PIXEL21_C
@@ -672,7 +653,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 112:
                 case 113: {
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL20_1L
                         PIXEL21_C
@@ -692,7 +673,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 200:
                 case 204: {
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_1M
                         PIXEL21_C
@@ -712,7 +693,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 73:
                 case 77: {
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL00_1U
                         PIXEL10_C
                         PIXEL20_1M
@@ -732,7 +713,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 42:
                 case 170: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                         PIXEL01_C
                         PIXEL10_C
@@ -752,7 +733,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 14:
                 case 142: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                         PIXEL01_C
                         PIXEL02_1R
@@ -868,7 +849,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 26:
                 case 31: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL10_C
                     } else {
@@ -876,7 +857,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL10_3
                     }
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_C
                         PIXEL12_C
                     } else {
@@ -892,7 +873,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 case 82:
                 case 214: {
                     PIXEL00_1M
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                     } else {
@@ -903,7 +884,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL11
                     PIXEL12_C
                     PIXEL20_1M
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL21_C
                         PIXEL22_C
                     } else {
@@ -918,7 +899,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL01_1
                     PIXEL02_1M
                     PIXEL11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                     } else {
@@ -926,7 +907,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL20_4
                     }
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL22_C
                     } else {
@@ -937,7 +918,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 74:
                 case 107: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                     } else {
@@ -948,7 +929,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_C
                         PIXEL21_C
                     } else {
@@ -959,7 +940,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 27: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL10_C
@@ -978,7 +959,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 86: {
                     PIXEL00_1M
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                         PIXEL12_C
@@ -1001,7 +982,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL20_1M
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL21_C
                         PIXEL22_C
@@ -1018,7 +999,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL02_1M
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                         PIXEL21_C
@@ -1032,7 +1013,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 30: {
                     PIXEL00_1M
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                         PIXEL12_C
@@ -1055,7 +1036,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_1
                     PIXEL11
                     PIXEL20_1M
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL21_C
                         PIXEL22_C
@@ -1072,7 +1053,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL02_1M
                     PIXEL11
                     PIXEL12_C
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                         PIXEL21_C
@@ -1085,7 +1066,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 75: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL10_C
@@ -1247,13 +1228,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 58: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                     } else {
                         PIXEL00_2
                     }
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_1M
                     } else {
                         PIXEL02_2
@@ -1269,7 +1250,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 case 83: {
                     PIXEL00_1L
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_1M
                     } else {
                         PIXEL02_2
@@ -1279,7 +1260,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL12_C
                     PIXEL20_1M
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_1M
                     } else {
                         PIXEL22_2
@@ -1293,13 +1274,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_C
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_1M
                     } else {
                         PIXEL20_2
                     }
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_1M
                     } else {
                         PIXEL22_2
@@ -1307,7 +1288,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 202: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                     } else {
                         PIXEL00_2
@@ -1317,7 +1298,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_1M
                     } else {
                         PIXEL20_2
@@ -1327,7 +1308,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 78: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                     } else {
                         PIXEL00_2
@@ -1337,7 +1318,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_1M
                     } else {
                         PIXEL20_2
@@ -1347,13 +1328,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 154: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                     } else {
                         PIXEL00_2
                     }
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_1M
                     } else {
                         PIXEL02_2
@@ -1369,7 +1350,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 case 114: {
                     PIXEL00_1M
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_1M
                     } else {
                         PIXEL02_2
@@ -1379,7 +1360,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL12_C
                     PIXEL20_1L
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_1M
                     } else {
                         PIXEL22_2
@@ -1393,13 +1374,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_C
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_1M
                     } else {
                         PIXEL20_2
                     }
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_1M
                     } else {
                         PIXEL22_2
@@ -1407,13 +1388,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 90: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                     } else {
                         PIXEL00_2
                     }
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_1M
                     } else {
                         PIXEL02_2
@@ -1421,13 +1402,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_C
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_1M
                     } else {
                         PIXEL20_2
                     }
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_1M
                     } else {
                         PIXEL22_2
@@ -1436,7 +1417,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 55:
                 case 23: {
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL00_1L
                         PIXEL01_C
                         PIXEL02_C
@@ -1456,7 +1437,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 182:
                 case 150: {
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                         PIXEL12_C
@@ -1476,7 +1457,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 213:
                 case 212: {
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL02_1U
                         PIXEL12_C
                         PIXEL21_C
@@ -1496,7 +1477,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 241:
                 case 240: {
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL20_1L
                         PIXEL21_C
@@ -1516,7 +1497,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 236:
                 case 232: {
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                         PIXEL21_C
@@ -1536,7 +1517,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 109:
                 case 105: {
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL00_1U
                         PIXEL10_C
                         PIXEL20_C
@@ -1556,7 +1537,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 171:
                 case 43: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL10_C
@@ -1576,7 +1557,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 143:
                 case 15: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL02_1R
@@ -1600,7 +1581,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL02_1U
                     PIXEL11
                     PIXEL12_C
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                         PIXEL21_C
@@ -1613,7 +1594,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 203: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL10_C
@@ -1632,7 +1613,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 62: {
                     PIXEL00_1M
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                         PIXEL12_C
@@ -1655,7 +1636,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_1
                     PIXEL11
                     PIXEL20_1M
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL21_C
                         PIXEL22_C
@@ -1668,7 +1649,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 118: {
                     PIXEL00_1M
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                         PIXEL12_C
@@ -1691,7 +1672,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL20_1M
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL21_C
                         PIXEL22_C
@@ -1708,7 +1689,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL02_1R
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                         PIXEL21_C
@@ -1721,7 +1702,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 155: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL10_C
@@ -1840,12 +1821,12 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL02_1U
                     PIXEL10_C
                     PIXEL11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_1M
                     } else {
                         PIXEL20_2
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL21_C
                         PIXEL22_C
@@ -1857,12 +1838,12 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 158: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                     } else {
                         PIXEL00_2
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                         PIXEL12_C
@@ -1879,7 +1860,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 234: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                     } else {
                         PIXEL00_2
@@ -1888,7 +1869,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL02_1M
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                         PIXEL21_C
@@ -1903,7 +1884,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 case 242: {
                     PIXEL00_1M
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_1M
                     } else {
                         PIXEL02_2
@@ -1911,7 +1892,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_1
                     PIXEL11
                     PIXEL20_1L
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL21_C
                         PIXEL22_C
@@ -1923,7 +1904,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 59: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL10_C
@@ -1932,7 +1913,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL01_3
                         PIXEL10_3
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_1M
                     } else {
                         PIXEL02_2
@@ -1950,7 +1931,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL02_1M
                     PIXEL11
                     PIXEL12_C
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                         PIXEL21_C
@@ -1959,7 +1940,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL20_4
                         PIXEL21_3
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_1M
                     } else {
                         PIXEL22_2
@@ -1968,7 +1949,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 87: {
                     PIXEL00_1L
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                         PIXEL12_C
@@ -1981,7 +1962,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL11
                     PIXEL20_1M
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_1M
                     } else {
                         PIXEL22_2
@@ -1989,7 +1970,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 79: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL10_C
@@ -2001,7 +1982,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL02_1R
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_1M
                     } else {
                         PIXEL20_2
@@ -2011,20 +1992,20 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 122: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                     } else {
                         PIXEL00_2
                     }
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_1M
                     } else {
                         PIXEL02_2
                     }
                     PIXEL11
                     PIXEL12_C
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                         PIXEL21_C
@@ -2033,7 +2014,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL20_4
                         PIXEL21_3
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_1M
                     } else {
                         PIXEL22_2
@@ -2041,12 +2022,12 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 94: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                     } else {
                         PIXEL00_2
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                         PIXEL12_C
@@ -2057,13 +2038,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     }
                     PIXEL10_C
                     PIXEL11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_1M
                     } else {
                         PIXEL20_2
                     }
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_1M
                     } else {
                         PIXEL22_2
@@ -2071,25 +2052,25 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 218: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                     } else {
                         PIXEL00_2
                     }
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_1M
                     } else {
                         PIXEL02_2
                     }
                     PIXEL10_C
                     PIXEL11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_1M
                     } else {
                         PIXEL20_2
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL21_C
                         PIXEL22_C
@@ -2101,7 +2082,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 91: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL10_C
@@ -2110,20 +2091,20 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL01_3
                         PIXEL10_3
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_1M
                     } else {
                         PIXEL02_2
                     }
                     PIXEL11
                     PIXEL12_C
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_1M
                     } else {
                         PIXEL20_2
                     }
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_1M
                     } else {
                         PIXEL22_2
@@ -2179,13 +2160,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 186: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                     } else {
                         PIXEL00_2
                     }
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_1M
                     } else {
                         PIXEL02_2
@@ -2201,7 +2182,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 case 115: {
                     PIXEL00_1L
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_1M
                     } else {
                         PIXEL02_2
@@ -2211,7 +2192,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL12_C
                     PIXEL20_1L
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_1M
                     } else {
                         PIXEL22_2
@@ -2225,13 +2206,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_C
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_1M
                     } else {
                         PIXEL20_2
                     }
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_1M
                     } else {
                         PIXEL22_2
@@ -2239,7 +2220,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 206: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                     } else {
                         PIXEL00_2
@@ -2249,7 +2230,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_1M
                     } else {
                         PIXEL20_2
@@ -2266,7 +2247,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_1M
                     } else {
                         PIXEL20_2
@@ -2277,7 +2258,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 174:
                 case 46: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_1M
                     } else {
                         PIXEL00_2
@@ -2296,7 +2277,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 case 147: {
                     PIXEL00_1L
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_1M
                     } else {
                         PIXEL02_2
@@ -2319,7 +2300,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL12_C
                     PIXEL20_1L
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_1M
                     } else {
                         PIXEL22_2
@@ -2352,7 +2333,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 126: {
                     PIXEL00_1M
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                         PIXEL12_C
@@ -2362,7 +2343,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL12_3
                     }
                     PIXEL11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                         PIXEL21_C
@@ -2375,7 +2356,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 219: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL10_C
@@ -2387,7 +2368,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL02_1M
                     PIXEL11
                     PIXEL20_1M
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL21_C
                         PIXEL22_C
@@ -2399,7 +2380,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 125: {
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL00_1U
                         PIXEL10_C
                         PIXEL20_C
@@ -2418,7 +2399,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 221: {
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL02_1U
                         PIXEL12_C
                         PIXEL21_C
@@ -2437,7 +2418,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 207: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL02_1R
@@ -2456,7 +2437,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 238: {
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                         PIXEL21_C
@@ -2475,7 +2456,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 190: {
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                         PIXEL12_C
@@ -2494,7 +2475,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 187: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL10_C
@@ -2513,7 +2494,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 243: {
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL20_1L
                         PIXEL21_C
@@ -2532,7 +2513,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 119: {
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL00_1L
                         PIXEL01_C
                         PIXEL02_C
@@ -2558,7 +2539,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_C
                     } else {
                         PIXEL20_2
@@ -2569,7 +2550,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 175:
                 case 47: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                     } else {
                         PIXEL00_2
@@ -2588,7 +2569,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 case 151: {
                     PIXEL00_1L
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_C
                     } else {
                         PIXEL02_2
@@ -2611,7 +2592,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL12_C
                     PIXEL20_1L
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_C
                     } else {
                         PIXEL22_2
@@ -2623,7 +2604,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL01_C
                     PIXEL02_1M
                     PIXEL11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                     } else {
@@ -2631,7 +2612,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL20_4
                     }
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL22_C
                     } else {
@@ -2641,7 +2622,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 123: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                     } else {
@@ -2652,7 +2633,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_C
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_C
                         PIXEL21_C
                     } else {
@@ -2663,7 +2644,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 95: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL10_C
                     } else {
@@ -2671,7 +2652,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL10_3
                     }
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_C
                         PIXEL12_C
                     } else {
@@ -2686,7 +2667,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 222: {
                     PIXEL00_1M
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                     } else {
@@ -2697,7 +2678,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL11
                     PIXEL12_C
                     PIXEL20_1M
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL21_C
                         PIXEL22_C
                     } else {
@@ -2712,7 +2693,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL02_1U
                     PIXEL11
                     PIXEL12_C
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                     } else {
@@ -2720,7 +2701,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL20_4
                     }
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_C
                     } else {
                         PIXEL22_2
@@ -2733,13 +2714,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL02_1M
                     PIXEL10_C
                     PIXEL11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_C
                     } else {
                         PIXEL20_2
                     }
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL22_C
                     } else {
@@ -2749,7 +2730,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 235: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                     } else {
@@ -2760,7 +2741,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_C
                     } else {
                         PIXEL20_2
@@ -2770,7 +2751,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 111: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                     } else {
                         PIXEL00_2
@@ -2780,7 +2761,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_C
                         PIXEL21_C
                     } else {
@@ -2791,13 +2772,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 63: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                     } else {
                         PIXEL00_2
                     }
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_C
                         PIXEL12_C
                     } else {
@@ -2812,7 +2793,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 159: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL10_C
                     } else {
@@ -2820,7 +2801,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL10_3
                     }
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_C
                     } else {
                         PIXEL02_2
@@ -2835,7 +2816,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 case 215: {
                     PIXEL00_1L
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_C
                     } else {
                         PIXEL02_2
@@ -2844,7 +2825,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL11
                     PIXEL12_C
                     PIXEL20_1M
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL21_C
                         PIXEL22_C
                     } else {
@@ -2855,7 +2836,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 246: {
                     PIXEL00_1M
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                     } else {
@@ -2867,7 +2848,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL12_C
                     PIXEL20_1L
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_C
                     } else {
                         PIXEL22_2
@@ -2876,7 +2857,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 }
                 case 254: {
                     PIXEL00_1M
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                     } else {
@@ -2884,14 +2865,14 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL02_4
                     }
                     PIXEL11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                     } else {
                         PIXEL10_3
                         PIXEL20_4
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL21_C
                         PIXEL22_C
@@ -2909,13 +2890,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_C
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_C
                     } else {
                         PIXEL20_2
                     }
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_C
                     } else {
                         PIXEL22_2
@@ -2923,7 +2904,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 251: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                     } else {
@@ -2932,7 +2913,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     }
                     PIXEL02_1M
                     PIXEL11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL10_C
                         PIXEL20_C
                         PIXEL21_C
@@ -2941,7 +2922,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL20_2
                         PIXEL21_3
                     }
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL12_C
                         PIXEL22_C
                     } else {
@@ -2951,7 +2932,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 239: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                     } else {
                         PIXEL00_2
@@ -2961,7 +2942,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_1
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_C
                     } else {
                         PIXEL20_2
@@ -2971,7 +2952,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 127: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL01_C
                         PIXEL10_C
@@ -2980,7 +2961,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL01_3
                         PIXEL10_3
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_C
                         PIXEL12_C
                     } else {
@@ -2988,7 +2969,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                         PIXEL12_3
                     }
                     PIXEL11
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_C
                         PIXEL21_C
                     } else {
@@ -2999,13 +2980,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 191: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                     } else {
                         PIXEL00_2
                     }
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_C
                     } else {
                         PIXEL02_2
@@ -3019,14 +3000,14 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 223: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                         PIXEL10_C
                     } else {
                         PIXEL00_4
                         PIXEL10_3
                     }
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL01_C
                         PIXEL02_C
                         PIXEL12_C
@@ -3037,7 +3018,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     }
                     PIXEL11
                     PIXEL20_1M
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL21_C
                         PIXEL22_C
                     } else {
@@ -3049,7 +3030,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                 case 247: {
                     PIXEL00_1L
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_C
                     } else {
                         PIXEL02_2
@@ -3059,7 +3040,7 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL12_C
                     PIXEL20_1L
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_C
                     } else {
                         PIXEL22_2
@@ -3067,13 +3048,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     break;
                 }
                 case 255: {
-                    if (Diff(w[4], w[2])) {
+                    if (DiffYUV(yuv[4], yuv[2])) {
                         PIXEL00_C
                     } else {
                         PIXEL00_2
                     }
                     PIXEL01_C
-                    if (Diff(w[2], w[6])) {
+                    if (DiffYUV(yuv[2], yuv[6])) {
                         PIXEL02_C
                     } else {
                         PIXEL02_2
@@ -3081,13 +3062,13 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
                     PIXEL10_C
                     PIXEL11
                     PIXEL12_C
-                    if (Diff(w[8], w[4])) {
+                    if (DiffYUV(yuv[8], yuv[4])) {
                         PIXEL20_C
                     } else {
                         PIXEL20_2
                     }
                     PIXEL21_C
-                    if (Diff(w[6], w[8])) {
+                    if (DiffYUV(yuv[6], yuv[8])) {
                         PIXEL22_C
                     } else {
                         PIXEL22_2
@@ -3098,3 +3079,11 @@ void hq3x(Pixbuf const &src, Pixbuf &dst) {
         }
     }
 }
+
+
+void hq3x(Pixbuf const &src, Pixbuf &dst) {
+    HqxSource source(src);
+    gd_parallel_rows(source.get_height(), dst.get_width() * 3, [&](int first, int last) {
+        hq3x_rows(source, dst, first, last);
+    });
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2007-2018, GDash Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <cstring>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "gfx/pixbufmanip_hqx.hpp"
+#include "misc/threadpool.hpp"
+
+
+HqxSource::HqxSource(Pixbuf const &src)
+    : width(src.get_width()), height(src.get_height()),
+      rgb((width + 2) * (height + 2)), yuv((width + 2) * (height + 2)), patterns(width * height) {
+    if (width == 0 || height == 0)
+        return;
+
+    /* copy the pixels, and convert every one of them to yuv only once. the border
+     * rows and columns are the ones from the other side of the image. */
+    for (int y = -1; y <= height; y++) {
+        guint32 const *srcrow = src.get_row((y + height) % height);
+        guint32 *rgbrow = &rgb[(y + 1) * (width + 2) + 1];
+        guint32 *yuvrow = &yuv[(y + 1) * (width + 2) + 1];
+        for (int x = -1; x <= width; x++) {
+            rgbrow[x] = srcrow[(x + width) % width];
+            yuvrow[x] = RGBtoYUV(rgbrow[x]);
+        }
+    }
+
+    gd_parallel_rows(height, width, [this](int first, int last) {
+        for (int y = first; y < last; y++)
+            calculate_patterns(y);
+    });
+}
+
+
+/* calculate the pattern codes of a row. the bit for a neighbour is set,
+ * if DiffYUV() says that it is different from the middle pixel.
+ * the pixels are numbered like this: 1 2 3 / 4 5 6 / 7 8 9, and
+ * the bits are assigned to them in this order, skipping the middle one. */
+void HqxSource::calculate_patterns(int y) {
+    guint32 const *prev = yuv_row(y - 1), *line = yuv_row(y), *next = yuv_row(y + 1);
+    guint32 const *neighbours[8] = { prev - 1, prev, prev + 1, line - 1, line + 1, next - 1, next, next + 1 };
+    guint8 *pattern = &patterns[y * width];
+
+    int x = 0;
+#ifdef __SSE2__
+    /* for the four pixels at once. the absolute difference of the y, u, v bytes
+     * is calculated with saturating subtractions; it is above the threshold,
+     * if subtracting the threshold still leaves something. */
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const threshold = _mm_set1_epi32(trY | trU | trV);
+    for (; x + 4 <= width; x += 4) {
+        __m128i middle = _mm_loadu_si128((__m128i const *) &line[x]);
+        __m128i code = zero;
+        for (int k = 0; k < 8; k++) {
+            __m128i other = _mm_loadu_si128((__m128i const *) &neighbours[k][x]);
+            __m128i absdiff = _mm_or_si128(_mm_subs_epu8(middle, other), _mm_subs_epu8(other, middle));
+            __m128i same = _mm_cmpeq_epi32(_mm_subs_epu8(absdiff, threshold), zero);
+            code = _mm_or_si128(code, _mm_andnot_si128(same, _mm_set1_epi32(1 << k)));
+        }
+        code = _mm_packus_epi16(_mm_packs_epi32(code, zero), zero);
+        gint32 codes = _mm_cvtsi128_si32(code);
+        memcpy(&pattern[x], &codes, 4);
+    }
+#endif
+    for (; x < width; x++) {
+        int code = 0;
+        for (int k = 0; k < 8; k++)
+            if (DiffYUV(line[x], neighbours[k][x]))
+                code |= 1 << k;
+        pattern[x] = code;
+    }
+}
@@ -28,6 +28,7 @@
 
 #include <glib.h>
 #include <cstdlib>
+#include <vector>
 #include "gfx/pixbuf.hpp"
 
 #define Ymask 0x00FF0000
@@ -57,15 +58,58 @@ inline guint32 RGBtoYUV(guint32 c) {
     return (y << 16) + (u << 8) + v;
 }
 
-/* Test if there is difference in color */
-inline int Diff(guint32 w1, guint32 w2) {
-    guint32 YUV1 = RGBtoYUV(w1);
-    guint32 YUV2 = RGBtoYUV(w2);
+/* Test if there is difference in color, for colors already converted to yuv */
+inline int DiffYUV(guint32 YUV1, guint32 YUV2) {
     return (abs(gint32(YUV1 & Ymask) - gint32(YUV2 & Ymask)) > trY)
            || (abs(gint32(YUV1 & Umask) - gint32(YUV2 & Umask)) > trU)
            || (abs(gint32(YUV1 & Vmask) - gint32(YUV2 & Vmask)) > trV);
 }
 
+/* Test if there is difference in color */
+inline int Diff(guint32 w1, guint32 w2) {
+    return DiffYUV(RGBtoYUV(w1), RGBtoYUV(w2));
+}
+
+
+/**
+ * The source image of the hqx scalers, prepared for the case tables.
+ *
+ * Stores the pixels and their yuv values with a one pixel wide border
+ * around them, which holds the pixels from the other side of the image.
+ * So the neighbours of a pixel can be read without checking the edges:
+ * rgb_row(-1) is the last row, rgb_row(y)[-1] is the last pixel of the row.
+ * Also stores the pattern code of every pixel, the bits of which tell
+ * which of the eight neighbours differ in color from the pixel itself.
+ */
+class HqxSource {
+public:
+    explicit HqxSource(Pixbuf const &src);
+
+    int get_width() const {
+        return width;
+    }
+    int get_height() const {
+        return height;
+    }
+    guint32 const *rgb_row(int y) const {
+        return &rgb[(y + 1) * (width + 2) + 1];
+    }
+    guint32 const *yuv_row(int y) const {
+        return &yuv[(y + 1) * (width + 2) + 1];
+    }
+    guint8 const *pattern_row(int y) const {
+        return &patterns[y * width];
+    }
+
+private:
+    int width, height;
+    std::vector<guint32> rgb;
+    std::vector<guint32> yuv;
+    std::vector<guint8> patterns;
+
+    void calculate_patterns(int y);
+};
+
 /* Interpolate functions */
 inline void Interp1(guint32 *pc, guint32 c1, guint32 c2) {
     //*pc = (c1*3+c2)/4;
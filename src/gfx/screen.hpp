@@ -32,7 +32,7 @@
 #include "gfx/pixbuffactory.hpp"
 
 class GdColor;
-class ParticleSet;
+class ParticleSystem;
 class Pixbuf;
 class PixmapStorage;
 
@@ -100,6 +100,11 @@ public:
         return scaling_factor;
     }
 
+    /// @brief Return the scaling algorithm of the pixbuf->pixmap.
+    GdScalingType get_scaling_type() const {
+        return scaling_type;
+    }
+
     /// @brief Returns true, if the screen uses software pal emulation.
     bool get_pal_emulation() const {
         return pal_emulation;
@@ -128,10 +133,25 @@ public:
     virtual void blit(Pixmap const &src, int dx, int dy) const = 0;
     void blit_pixbuf(Pixbuf const &src, int dx, int dy, bool keep_alpha);
 
+    /// @brief Create an offscreen layer, which can be drawn on with blit_to_layer(),
+    /// and then blitted to the screen like any other pixmap. Blitting the layer
+    /// copies it, without blending.
+    /// @return The new layer, or a NULL pointer if layers are not supported.
+    virtual std::unique_ptr<Pixmap> create_layer(int w, int h) const {
+        return NULL;
+    }
+    /// @brief Blit a pixmap onto a layer created by create_layer().
+    virtual void blit_to_layer(Pixmap &layer, Pixmap const &src, int dx, int dy) const {}
+
     virtual void set_clip_rect(int x1, int y1, int w, int h) = 0;
     virtual void remove_clip_rect() = 0;
 
-    virtual void draw_particle_set(int dx, int dy, ParticleSet const &ps) {}
+    virtual void draw_particles(int dx, int dy, ParticleSystem const &particles) {}
+    /// @brief Returns if draw_particles() draws into the screen like the other drawing functions.
+    /// If it does, the cells under the particles must be drawn again in the next frame.
+    virtual bool draws_particles_on_surface() const {
+        return true;
+    }
 
     /** 
      * Tell the graphics system to accept text input;
@@ -203,21 +203,25 @@ std::unique_ptr<Pixmap> GTKScreen::create_pixmap_from_pixbuf(const Pixbuf &pb, b
 }
 
 
-void GTKScreen::draw_particle_set(int dx, int dy, ParticleSet const &ps) {
-    unsigned char r, g, b;
-    ps.color.get_rgb(r, g, b);
-    cairo_set_source_rgba(cr.get(), r / 255.0, g / 255.0, b / 255.0, ps.life / 1000.0 * ps.opacity);
-    int size = ceil(ps.size);
-    /* cairo gets the center of the pixel, like opengl. because it works with
-     * float coordinates, not integers.
-     * dx0, dy0 are the center, and the sides "outgrow". */
-    double dxm = dx - size, dx0 = dx + 0.5, dxp = dx + size + 1;
-    double dym = dy - size, dy0 = dy + 0.5, dyp = dy + size + 1;
-    for (ParticleSet::const_iterator it = ps.begin(); it != ps.end(); ++it) {
-        cairo_move_to(cr.get(), (int)it->px + dx0, (int)it->py + dym);
-        cairo_line_to(cr.get(), (int)it->px + dxp, (int)it->py + dy0);
-        cairo_line_to(cr.get(), (int)it->px + dx0, (int)it->py + dyp);
-        cairo_line_to(cr.get(), (int)it->px + dxm, (int)it->py + dy0);
-        cairo_fill(cr.get());
+void GTKScreen::draw_particles(int dx, int dy, ParticleSystem const &particles) {
+    float const *px = particles.px(), *py = particles.py();
+    for (unsigned s = 0; s < particles.num_sets(); ++s) {
+        ParticleSet const &ps = particles.set(s);
+        unsigned char r, g, b;
+        ps.color.get_rgb(r, g, b);
+        cairo_set_source_rgba(cr.get(), r / 255.0, g / 255.0, b / 255.0, ps.life / 1000.0 * ps.opacity);
+        int size = ceil(ps.size);
+        /* cairo gets the center of the pixel, like opengl. because it works with
+         * float coordinates, not integers.
+         * dx0, dy0 are the center, and the sides "outgrow". */
+        double dxm = dx - size, dx0 = dx + 0.5, dxp = dx + size + 1;
+        double dym = dy - size, dy0 = dy + 0.5, dyp = dy + size + 1;
+        for (unsigned i = ps.first; i < ps.first + ps.count; ++i) {
+            cairo_move_to(cr.get(), (int)px[i] + dx0, (int)py[i] + dym);
+            cairo_line_to(cr.get(), (int)px[i] + dxp, (int)py[i] + dy0);
+            cairo_line_to(cr.get(), (int)px[i] + dx0, (int)py[i] + dyp);
+            cairo_line_to(cr.get(), (int)px[i] + dxm, (int)py[i] + dy0);
+            cairo_fill(cr.get());
+        }
     }
 }
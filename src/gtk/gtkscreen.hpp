@@ -32,7 +32,7 @@
 #include "misc/deleter.hpp"
 
 class PixbufFactory;
-class ParticleSet;
+class ParticleSystem;
 
 /** Implementation of the Pixmap interface, using GTK+ cairo functions. */
 class GTKPixmap: public Pixmap {
@@ -90,7 +90,7 @@ public:
 
     virtual void fill_rect(int x, int y, int w, int h, const GdColor &c);
     virtual void blit(Pixmap const &src, int dx, int dy) const;
-    virtual void draw_particle_set(int dx, int dy, ParticleSet const &ps);
+    virtual void draw_particles(int dx, int dy, ParticleSystem const &particles);
 
     virtual void set_clip_rect(int x1, int y1, int w, int h);
     virtual void remove_clip_rect();
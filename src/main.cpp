@@ -39,9 +39,12 @@
 #endif
 
 #include "cave/caveset.hpp"
+#include "cave/caverendered.hpp"
+#include "cave/helper/cavereplay.hpp"
 #include "sound/sound.hpp"
 #include "misc/util.hpp"
 #include "misc/logger.hpp"
+#include "misc/threadpool.hpp"
 #include "misc/about.hpp"
 #include "settings.hpp"
 #include "framework/commands.hpp"
@@ -81,6 +84,9 @@ int main(int argc, char *argv[]) {
     char *png_filename = NULL, *png_size = NULL;
     char *save_cave_name = NULL, *save_gds_name = NULL;
     int exportcrli = 0;
+    int verify_replays = 0;
+    int verify_threads = 0;
+    int replays_failed = 0;
     char *save_cave_name_flat = NULL;
 #ifdef HAVE_GTK
     int save_doc_lang = -1;
@@ -101,6 +107,8 @@ int main(int argc, char *argv[]) {
         {"save-gds", 'd', 0, G_OPTION_ARG_FILENAME, &save_gds_name, N_("Save imported binary data to a GDS file. An input file name is required.")},
         {"save-crli", 'x', 0, G_OPTION_ARG_NONE, &exportcrli, N_("Save caveset in CrLi files")},
         {"save-flat", 'f', 0, G_OPTION_ARG_FILENAME, &save_cave_name_flat, N_("Save caveset in flattened format")},
+        {"verify-replays", 0, 0, G_OPTION_ARG_NONE, &verify_replays, N_("Play all replays of the caveset without graphics, and check their results. If more files are given, all of them are checked.")},
+        {"verify-threads", 0, 0, G_OPTION_ARG_INT, &verify_threads, N_("Number of threads to verify replays with. Default is the number of processor cores.")},
 #ifdef HAVE_GTK
         {"save-docs", 0, 0, G_OPTION_ARG_INT, &save_doc_lang, N_("Save documentation in HTML, in the given language identified by an integer.")},
 #endif
@@ -258,6 +266,68 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    /* play all replays at full engine speed, and compare the results to the recorded ones.
+     * if more files are given, the replays of all of them are checked. */
+    if (verify_replays) {
+        /* the first file is already loaded; only keep the cavesets which have replays */
+        std::vector<CaveSet> cavesets;
+        std::vector<std::string> setnames;
+        cavesets.push_back(caveset);
+        setnames.push_back(gd_param_cavenames && gd_param_cavenames[0] ? gd_param_cavenames[0] : caveset.name.c_str());
+        for (int i = 1; gd_param_cavenames && gd_param_cavenames[i]; ++i) {
+            try {
+                CaveSet set = load_caveset_from_file(gd_param_cavenames[i]);
+                if (set.has_replays()) {
+                    cavesets.push_back(set);
+                    setnames.push_back(gd_param_cavenames[i]);
+                }
+            } catch (std::exception &e) {
+                gd_critical("%s: %s", gd_param_cavenames[i], e.what());
+            }
+        }
+
+        /* collect the jobs. the results are stored in the same order, so the
+         * report does not depend on which thread finished first */
+        struct ReplayJob {
+            unsigned caveset;
+            CaveStored *cave;
+            CaveReplay *replay;
+        };
+        std::vector<ReplayJob> jobs;
+        for (unsigned s = 0; s < cavesets.size(); s++)
+            for (unsigned n = 0; n < cavesets[s].caves.size(); n++) {
+                CaveStored &cave = cavesets[s].caves[n];
+                for (std::list<CaveReplay>::iterator it = cave.replays.begin(); it != cave.replays.end(); ++it)
+                    jobs.push_back(ReplayJob {s, &cave, &*it});
+            }
+        std::vector<ReplayVerifyResult> results(jobs.size());
+
+        /* nobody sees the particles, so do not spend time on them */
+        bool particle_effects = gd_particle_effects;
+        gd_particle_effects = false;
+        gd_parallel_for(jobs.size(), [&](unsigned i) {
+            /* messages of the worker threads go to their own logger, and are printed to the console */
+            Logger logger;
+            results[i] = gd_cave_verify_replay(*jobs[i].cave, *jobs[i].replay);
+            logger.clear();
+        }, verify_threads > 0 ? verify_threads : 0);
+        gd_particle_effects = particle_effects;
+
+        for (unsigned i = 0; i < jobs.size(); i++) {
+            ReplayVerifyResult const &result = results[i];
+            CaveReplay const &replay = *jobs[i].replay;
+            if (cavesets.size() > 1 && (i == 0 || jobs[i].caveset != jobs[i - 1].caveset))
+                g_print("%s:\n", setnames[jobs[i].caveset].c_str());
+            if (!result.matches)
+                replays_failed++;
+            g_print("%s: %s, level %d, %s: %s, score %d, diamonds %d, frames %d\n",
+                    result.matches ? "OK" : "FAILED", jobs[i].cave->name.c_str(), (int) replay.level, replay.player_name.c_str(),
+                    !result.checksum_ok ? "wrong checksum" : result.success ? "success" : "not successful",
+                    result.score, result.diamonds, result.frames);
+        }
+        g_print("%d replays played, %d failed\n", (int) jobs.size(), replays_failed);
+    }
+
     /* flatten all caves */
     if (save_cave_name_flat) {
        gd_message("Flatten caves...");
@@ -309,7 +379,7 @@ int main(int argc, char *argv[]) {
     /* if batch mode, quit now */
     if (quit) {
         global_logger.clear();
-        return 0;
+        return replays_failed > 0 ? 1 : 0;
     }
 #ifdef HAVE_GTK
     if (force_quit_no_gtk) {
@@ -194,6 +194,9 @@ helpdata const gamehelp[] = {
     { NULL, NULL, "F2", O_NONE, N_("Random colors") },
     { NULL, NULL, "F3", O_NONE, N_("Take snapshot") },
     { NULL, NULL, "F4", O_NONE, N_("Revert to snapshot") },
+    { NULL, NULL, "F5", O_NONE, N_("Rewind") },
+    { NULL, NULL, "F6", O_NONE, N_("Forward after rewinding") },
+    { NULL, NULL, "F7", O_NONE, N_("Replay speed") },
     { NULL, NULL, "F8", O_NONE, N_("Cave variables (for testing)") },
     { NULL, NULL, "F9", O_NONE, N_("Sound volume") },
 #ifdef HAVE_GTK
@@ -220,7 +223,10 @@ helpdata const gamehelp[] = {
         "down the left shift button. These gameplay keys can be redefined in the options menu.")
     },
 
-    {NULL, N_("Snapshots"), NULL, O_NONE, N_("You can experiment with levels by saving and reloading snapshots. However, if you are playing a reloaded cave, you will not get score or extra lives.")},
+    {NULL, N_("Snapshots"), NULL, O_NONE, N_("You can experiment with levels by saving and reloading snapshots. However, if you are playing a reloaded cave, you will not get score or extra lives. "
+        "With F5, you can also rewind the cave a bit, and continue playing from there; F6 goes forward again, until you start moving. "
+        "After rewinding, the game does not give extra lives or highscores either. "
+        "When watching a replay, F5 and F6 jump backwards and forwards in it, and F7 changes its speed.")},
 
     // TRANSLATORS: Title text capitalization in English
     {NULL, N_("Inside the Cave"), NULL, O_NONE, NULL},
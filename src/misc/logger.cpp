@@ -24,12 +24,18 @@
 #include "config.h"
 
 #include <vector>
+#include <mutex>
 #include <glib.h>
 #include <iostream>
 
 #include "misc/logger.hpp"
 
-std::vector<Logger *> Logger::loggers;
+thread_local std::vector<Logger *> Logger::loggers;
+
+/// Number of Logger objects in all threads; the GLib log handler is
+/// installed while there is at least one.
+static int loggers_alive = 0;
+static std::mutex loggers_alive_mutex;
 
 static char severity_char(ErrorMessage::Severity sev) {
     switch (sev) {
@@ -79,8 +85,11 @@ Logger::Logger(bool ignore_)
     :
     ignore(ignore_) {
     /* if this is the first logger created */
-    if (loggers.empty())
-        g_log_set_default_handler(log_func, NULL);
+    {
+        std::lock_guard<std::mutex> lock(loggers_alive_mutex);
+        if (loggers_alive++ == 0)
+            g_log_set_default_handler(log_func, NULL);
+    }
     /* add this logger to list of loggers, so we always know which was last */
     loggers.push_back(this);
 }
@@ -95,7 +104,8 @@ Logger::~Logger() {
     }
     assert(loggers.back() == this);
     loggers.pop_back();
-    if (loggers.empty())
+    std::lock_guard<std::mutex> lock(loggers_alive_mutex);
+    if (--loggers_alive == 0)
         g_log_set_default_handler(g_log_default_handler, NULL);
 }
 
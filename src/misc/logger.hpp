@@ -68,7 +68,9 @@ struct ErrorMessage {
  * log handler is also installed by the misc/logger.
  *
  * The Logger class keeps track of all Logger objects in
- * existence, using the loggers static variable.
+ * existence, using the loggers static variable. This list is
+ * kept separately for every thread, so a worker thread which
+ * creates its own Logger object receives its own messages.
  * Global error logging functions are provided for simple
  * usage - they allow callers to use the logging facility
  * without the need of passing the references to a logger
@@ -110,7 +112,7 @@ struct ErrorMessage {
  */
 class Logger {
 private:
-    static std::vector<Logger *> loggers;
+    static thread_local std::vector<Logger *> loggers;
 public:
     typedef std::vector<ErrorMessage> Container;
     typedef Container::const_iterator ConstIterator;
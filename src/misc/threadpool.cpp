@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2007-2018, GDash Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <exception>
+
+#include "misc/threadpool.hpp"
+
+namespace {
+
+/// Worker threads, started once and kept for the whole run of the program.
+/// They run the tasks given to them in the order of submitting.
+class ThreadPool {
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::deque<std::function<void()>> tasks;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+
+    void run() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit ThreadPool(unsigned count) {
+        for (unsigned i = 0; i < count; ++i)
+            workers.push_back(std::thread([this] { run(); }));
+    }
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool &operator=(ThreadPool const &) = delete;
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (auto &w : workers)
+            w.join();
+    }
+
+    unsigned size() const {
+        return workers.size();
+    }
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wakeup.notify_one();
+    }
+};
+
+
+/// The pool used by gd_parallel_for. The calling thread also works,
+/// so one thread less is started than the number of cores.
+ThreadPool &thread_pool() {
+    static ThreadPool pool(gd_thread_count() - 1);
+    return pool;
+}
+
+
+/// The state of one gd_parallel_for call, shared by the threads working on it.
+/// Every thread takes the next job number when it has finished the previous one,
+/// so a few long jobs do not keep the other threads idle.
+class ParallelJobs {
+    std::function<void(unsigned)> const &job;
+    unsigned const count;
+    std::atomic<unsigned> next;
+    std::mutex mutex;
+    std::condition_variable all_done;
+    unsigned finished = 0;
+    std::exception_ptr first_exception;
+
+public:
+    ParallelJobs(std::function<void(unsigned)> const &job, unsigned count)
+        : job(job), count(count), next(0) {
+    }
+
+    /// Run jobs until there are none left. A pool thread may call this only after
+    /// the gd_parallel_for call returned; then it does not touch the job anymore.
+    void work() {
+        for (;;) {
+            unsigned i = next++;
+            if (i >= count)
+                return;
+            std::exception_ptr exception;
+            try {
+                job(i);
+            } catch (...) {
+                exception = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (exception && !first_exception)
+                first_exception = exception;
+            if (++finished == count)
+                all_done.notify_all();
+        }
+    }
+
+    /// Wait for the jobs taken by other threads to finish, and rethrow the first exception.
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        all_done.wait(lock, [this] { return finished == count; });
+        if (first_exception)
+            std::rethrow_exception(first_exception);
+    }
+};
+
+}
+
+
+unsigned gd_thread_count() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+
+void gd_parallel_for(unsigned count, std::function<void(unsigned)> const &job, unsigned threads) {
+    if (threads == 0)
+        threads = gd_thread_count();
+    if (threads > count)
+        threads = count;
+    ThreadPool &pool = thread_pool();
+    if (threads > pool.size() + 1)
+        threads = pool.size() + 1;
+    if (threads <= 1) {
+        for (unsigned i = 0; i < count; ++i)
+            job(i);
+        return;
+    }
+
+    /* the helpers may be started only when the pool threads finished their other
+     * tasks, even after all jobs are done, so they share the state with the caller.
+     * the caller works, too, so the jobs finish even if no helper starts in time;
+     * this is why a job can call gd_parallel_for itself. */
+    auto jobs = std::make_shared<ParallelJobs>(job, count);
+    for (unsigned t = 1; t < threads; ++t)
+        pool.submit([jobs] { jobs->work(); });
+    jobs->work();
+    jobs->wait();
+}
+
+
+void gd_parallel_rows(int height, int row_pixels, std::function<void(int first, int last)> const &rows) {
+    int const band_height = 16;
+    int const min_pixels_for_threads = 256 * 256;
+    if (height <= band_height || height * row_pixels < min_pixels_for_threads) {
+        rows(0, height);
+        return;
+    }
+    unsigned bands = (height + band_height - 1) / band_height;
+    gd_parallel_for(bands, [&](unsigned band) {
+        int first = band * band_height;
+        rows(first, std::min(first + band_height, height));
+    });
+}
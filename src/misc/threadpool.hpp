@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2007-2018, GDash Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef THREADPOOL_HPP_INCLUDED
+#define THREADPOOL_HPP_INCLUDED
+
+#include "config.h"
+
+#include <functional>
+
+/// @brief The number of threads worth starting for parallel work.
+/// This is the number of CPU cores, or 1 if that is unknown.
+unsigned gd_thread_count();
+
+/// @brief Run job(0), job(1) ... job(count-1) on a number of threads.
+/// The threads are the workers of a pool, started at the first call and kept
+/// until the program exits, and the calling thread, which also works.
+/// Every thread takes the next job number when it has finished the previous
+/// one, so a few long jobs do not keep the other threads idle. The function
+/// returns only when all jobs are finished. A job may call gd_parallel_for itself.
+/// The jobs should store their results indexed by the job number, so the order
+/// of the results does not depend on the scheduling.
+/// If a job throws an exception, the other jobs still run, and the first
+/// exception is rethrown to the caller.
+/// @param count The number of jobs.
+/// @param job The function to call with the job number.
+/// @param threads The number of threads to use, 0 for gd_thread_count().
+void gd_parallel_for(unsigned count, std::function<void(unsigned)> const &job, unsigned threads = 0);
+
+/// @brief Process the rows of an image in bands, on several threads if the image is large.
+/// Small images, like the cells, are processed on the calling thread in one band,
+/// as starting the work on other threads would cost more than it saves.
+/// The function must only write the rows belonging to its band.
+/// @param height The number of rows.
+/// @param row_pixels The number of pixels produced by processing one row.
+/// @param rows The function to call as rows(first, last) for the rows first <= y < last.
+void gd_parallel_rows(int height, int row_pixels, std::function<void(int first, int last)> const &rows);
+
+#endif
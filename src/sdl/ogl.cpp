@@ -26,6 +26,7 @@
 #include <stdexcept>
 
 #include "cave/gamerender.hpp"
+#include "cave/particle.hpp"
 #include "sdl/ogl.hpp"
 #include "sdl/sdlpixbuf.hpp"
 #include "settings.hpp"
@@ -96,6 +97,8 @@ SDLOGLScreen::SDLOGLScreen(PixbufFactory &pixbuf_factory)
     shader_support = false;
     timed_flips = false;
     oglscaling = 1;
+    w_padding = 0;
+    h_padding = 0;
 }
 
 
@@ -329,6 +332,7 @@ void SDLOGLScreen::configure_size() {
     texture.reset();
     shaders.clear();
     glprogram.reset();
+    uniform_locations.clear();
     surface.reset();
     context.reset();
     window.reset();
@@ -339,6 +343,7 @@ void SDLOGLScreen::configure_size() {
 
     /* create buffer */
     surface.reset(SDL_CreateRGBSurface(0, w, h, 32, Pixbuf::rmask, Pixbuf::gmask, Pixbuf::bmask, Pixbuf::amask));
+    dirty.resize(w, h);
 
     /* create screen */
     SDL_GL_SetAttribute(SDL_GL_RED_SIZE,   5);
@@ -351,8 +356,8 @@ void SDLOGLScreen::configure_size() {
     SDL_GL_SetSwapInterval(-1);
 
     // WORKAROUND to center OpenGL in full screen mode
-    int w_padding = 0;
-    int h_padding = 0;
+    w_padding = 0;
+    h_padding = 0;
     double scale = calculate_scaling_factor_for_monitor(&w_padding, &h_padding);
     if (gd_fullscreen)
         oglscaling = scale;
@@ -431,6 +436,10 @@ void SDLOGLScreen::configure_size() {
     set_texture_bilinear(false);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    /* the texture is allocated only once; flip() updates the changed parts of it,
+     * which are given as subrectangles of the surface. */
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, surface->pitch / surface->format->BytesPerPixel);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
     /* configure shaders */
     my_glCreateProgram = (MY_PFNGLCREATEPROGRAMPROC) my_glGetProcAddress("glCreateProgram");
@@ -455,6 +464,7 @@ void SDLOGLScreen::configure_size() {
         && my_glUniform1f && my_glUniform2f;
 
     glprogram.reset();
+    uniform_locations.clear();
     if (shader_support) {
         gd_debug("have shader support");
         const GLubyte *glsl_version = glGetString(MY_GL_SHADING_LANGUAGE_VERSION);
@@ -509,13 +519,27 @@ void SDLOGLScreen::configure_size() {
 }
 
 
+/**
+ * Get the location of an uniform variable in the shader program.
+ * The locations do not change until the program is relinked, so they are cached.
+ * @param name The name of the variable.
+ * @return The location, or -1 if there is no such variable.
+ */
+GLint SDLOGLScreen::uniform_location(char const *name) {
+    auto it = uniform_locations.find(name);
+    if (it == uniform_locations.end())
+        it = uniform_locations.insert(std::make_pair(name, my_glGetUniformLocation(glprogram.get(), name))).first;
+    return it->second;
+}
+
+
 /**
  * Set the value of an uniform float in the shader program.
  * @param name The name of the variable.
  * @param value The new value of the variable.
  */
 void SDLOGLScreen::set_uniform_float(char const *name, GLfloat value) {
-    GLint location = my_glGetUniformLocation(glprogram.get(), name);
+    GLint location = uniform_location(name);
     if (location != -1)  /* if such variable exists */
         my_glUniform1f(location, value);
 }
@@ -527,7 +551,7 @@ void SDLOGLScreen::set_uniform_float(char const *name, GLfloat value) {
  * @param value The new value of the variable.
  */
 void SDLOGLScreen::set_uniform_2float(char const *name, GLfloat value1, GLfloat value2) {
-    GLint location = my_glGetUniformLocation(glprogram.get(), name);
+    GLint location = uniform_location(name);
     if (location != -1)  /* if such variable exists */
         my_glUniform2f(location, value1, value2);
 }
@@ -543,7 +567,12 @@ void SDLOGLScreen::flip() {
      * the sdl back buffer must be rgba, as the pixmaps drawn are also rgba (they have transparency
      * info). if the back buffer were rgb and the pixmaps rgba, the sdl blit would be slow.
      * so better make everything rgba. */
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, surface->pixels);
+    /* only the parts drawn since the last flip are copied; when only a few cells
+     * changed, that is a small fraction of the screen. */
+    for (SDL_Rect const &r : dirty.take_rects()) {
+        Uint8 const *pixels = (Uint8 const *) surface->pixels + r.y * surface->pitch + r.x * surface->format->BytesPerPixel;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.w, r.h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    }
     /* seed the rng */
     if (glprogram) {
         /* now configure the shader with some sizes and coordinates */
@@ -570,5 +599,98 @@ void SDLOGLScreen::flip() {
     glTexCoord2f(1, 1); glVertex2f(w * oglscaling, h * oglscaling);
     glEnd();
 
+    /* the particles of this frame go over the cave */
+    if (!particle_vertices.empty())
+        draw_particle_batch();
+
     SDL_GL_SwapWindow(window.get());
 }
+
+
+/**
+ * Collect the particles to be drawn by the video card in the next flip().
+ * Drawing each diamond into the surface would cost cpu time proportional to their
+ * number and size; here only four vertices are generated for each particle, and
+ * the blending is done by OpenGL. If a shader is used, or pal emulation is
+ * requested, the particles must be processed together with the cave, so they
+ * are drawn into the surface as usual.
+ */
+void SDLOGLScreen::draw_particles(int dx, int dy, ParticleSystem const &particles) {
+    particle_vertices.clear();
+    particle_colors.clear();
+    if (draws_particles_on_surface()) {
+        SDLAbstractScreen::draw_particles(dx, dy, particles);
+        return;
+    }
+    if (particles.num_sets() == 0)
+        return;
+
+    SDL_GetClipRect(surface.get(), &particle_clip);
+    float const *px = particles.px(), *py = particles.py();
+    for (unsigned s = 0; s < particles.num_sets(); ++s) {
+        ParticleSet const &ps = particles.set(s);
+        GLubyte a = ps.life / 1000.0 * ps.opacity * 255;
+        if (a == 0)
+            continue;
+        unsigned char r, g, b;
+        ps.color.get_rgb(r, g, b);
+        /* same rounding as the software drawing: the diamond covers whole pixels
+         * from the center-r to center+r, so go to the edges of those pixels. */
+        GLfloat radius = (ceil(ps.size) + 0.5) * oglscaling;
+        for (unsigned i = ps.first; i < ps.first + ps.count; ++i) {
+            GLfloat x = (int(dx + px[i]) + 0.5) * oglscaling;
+            GLfloat y = (int(dy + py[i]) + 0.5) * oglscaling;
+            GLfloat const quad[] = {
+                x, y - radius,
+                x + radius, y,
+                x, y + radius,
+                x - radius, y,
+            };
+            particle_vertices.insert(particle_vertices.end(), quad, quad + 8);
+            for (int v = 0; v < 4; ++v) {
+                GLubyte const color[] = { r, g, b, a };
+                particle_colors.insert(particle_colors.end(), color, color + 4);
+            }
+        }
+    }
+}
+
+
+/**
+ * The particles are drawn by the video card over the surface, except if a shader
+ * or pal emulation is used.
+ */
+bool SDLOGLScreen::draws_particles_on_surface() const {
+    return glprogram || get_pal_emulation();
+}
+
+
+/**
+ * Draw the particles collected by draw_particles() with alpha blending,
+ * clipped to the rectangle they were submitted with. The batch is kept until
+ * the next draw_particles() call replaces it, as with vsync the window is
+ * flipped on every refresh, also when the game did not draw a new frame.
+ */
+void SDLOGLScreen::draw_particle_batch() {
+    /* the scissor box is in window coordinates, which start from the bottom */
+    glScissor(particle_clip.x * oglscaling + w_padding / 2,
+              (h - particle_clip.y - particle_clip.h) * oglscaling + h_padding / 2,
+              particle_clip.w * oglscaling, particle_clip.h * oglscaling);
+    glEnable(GL_SCISSOR_TEST);
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, particle_vertices.data());
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, particle_colors.data());
+    glDrawArrays(GL_QUADS, 0, particle_vertices.size() / 2);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    /* restore the state used for the background */
+    glDisable(GL_BLEND);
+    glEnable(GL_TEXTURE_2D);
+    glDisable(GL_SCISSOR_TEST);
+}
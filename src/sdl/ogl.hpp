@@ -29,6 +29,7 @@
 #include <glib.h>
 #include <string>
 #include <vector>
+#include <map>
 #include <algorithm>
 #include "sdl/sdlabstractscreen.hpp"
 #include "misc/deleter.hpp"
@@ -70,6 +71,7 @@ private:
     bool shader_support;
     bool timed_flips;
     double oglscaling;
+    int w_padding, h_padding;
     
     static void glDeleteProgram_wrapper(GLuint texture);
     GlResource<glDeleteProgram_wrapper> glprogram;
@@ -92,10 +94,22 @@ private:
     static void end_element(GMarkupParseContext *context, const gchar *element_name, gpointer user_data, GError **error);
     static void text(GMarkupParseContext *context, const gchar *text, gsize text_len, gpointer user_data, GError **error);
     
+    /// The locations of the uniforms of the shader program, so they are looked up only once.
+    std::map<std::string, GLint> uniform_locations;
+    GLint uniform_location(char const *name);
     void set_uniform_float(char const *name, GLfloat value);
     void set_uniform_2float(char const *name, GLfloat value1, GLfloat value2);
     void set_texture_bilinear(bool bilinear);
 
+    /// The particles of the last drawn frame, as diamond shaped quads in window coordinates.
+    /// They are drawn over the background texture by every flip() until the next
+    /// draw_particles() call replaces them; the vectors are kept to avoid allocation.
+    std::vector<GLfloat> particle_vertices;
+    std::vector<GLubyte> particle_colors;
+    /// The clip rectangle of the surface when the particles were submitted.
+    SDL_Rect particle_clip;
+    void draw_particle_batch();
+
 public:
     SDLOGLScreen(PixbufFactory &pixbuf_factory);
     virtual void set_properties(double scaling_factor_, GdScalingType scaling_type_, bool pal_emulation_) override;
@@ -103,6 +117,8 @@ public:
     virtual void configure_size() override;
     virtual void flip() override;
     virtual bool has_timed_flips() const override;
+    virtual void draw_particles(int dx, int dy, ParticleSystem const &particles) override;
+    virtual bool draws_particles_on_surface() const override;
     virtual std::unique_ptr<Pixmap> create_pixmap_from_pixbuf(Pixbuf const &pb, bool keep_alpha) const override;
 };
 
@@ -54,6 +54,9 @@ void SDLAbstractScreen::fill_rect(int x, int y, int w, int h, const GdColor &c)
     unsigned char r, g, b;
     c.get_rgb(r, g, b);
     SDL_FillRect(surface.get(), &dst, SDL_MapRGB(surface->format, r, g, b));
+    SDL_Rect clipped;
+    if (SDL_IntersectRect(&dst, &surface->clip_rect, &clipped))
+        dirty.add(clipped);
 }
 
 void SDLAbstractScreen::blit(Pixmap const &src, int dx, int dy) const {
@@ -62,7 +65,30 @@ void SDLAbstractScreen::blit(Pixmap const &src, int dx, int dy) const {
     dstr.x = dx;
     dstr.y = dy;
     /* the clipping in sdl_blitsurface is very fast, so we do not do any pre-clipping here */
-    SDL_BlitSurface(from, NULL, surface.get(), &dstr);
+    /* after blitting, dstr holds the clipped rectangle */
+    if (SDL_BlitSurface(from, NULL, surface.get(), &dstr) == 0)
+        dirty.add(dstr);
+}
+
+
+std::unique_ptr<Pixmap> SDLAbstractScreen::create_layer(int w, int h) const {
+    SDL_Surface *layer = SDL_CreateRGBSurface(0, w, h, 32,
+                         surface->format->Rmask, surface->format->Gmask, surface->format->Bmask, surface->format->Amask);
+    if (layer == NULL)
+        return NULL;
+    /* the layer is copied to the screen as it is */
+    SDL_SetSurfaceBlendMode(layer, SDL_BLENDMODE_NONE);
+    return std::make_unique<SDLPixmap>(layer);
+}
+
+
+void SDLAbstractScreen::blit_to_layer(Pixmap &layer, Pixmap const &src, int dx, int dy) const {
+    SDL_Surface *from = static_cast<SDLPixmap const &>(src).surface.get();
+    SDL_Surface *to = static_cast<SDLPixmap &>(layer).surface.get();
+    SDL_Rect dstr;
+    dstr.x = dx;
+    dstr.y = dy;
+    SDL_BlitSurface(from, NULL, to, &dstr);
 }
 
 
@@ -245,19 +271,30 @@ static void filledDiamondColor(SDL_Surface *dst, Sint16 xc, Sint16 yc, Sint16 r,
 }
 
 
-void SDLAbstractScreen::draw_particle_set(int dx, int dy, ParticleSet const &ps) {
-    unsigned char r, g, b;
-    ps.color.get_rgb(r, g, b);
-    Uint8 a = ps.life / 1000.0 * ps.opacity * 255;
-    Uint32 color = r << 24 | g << 16 | b << 8 | a << 0;
-    int size = ceil(ps.size);
+void SDLAbstractScreen::draw_particles(int dx, int dy, ParticleSystem const &particles) {
+    if (particles.num_sets() == 0)
+        return;
     if (SDL_MUSTLOCK(surface.get()))
         if (SDL_LockSurface(surface.get()) < 0)
             return;
     bool software_pal_emulation = get_pal_emulation();
-    for (ParticleSet::const_iterator it = ps.begin(); it != ps.end(); ++it) {
-        filledDiamondColor(surface.get(), dx + it->px, dy + it->py, size, color, software_pal_emulation);
+    if (SDLParticleCompositor::can_draw(surface.get())) {
+        /* the usual case: a 32-bit surface, all particles drawn in one pass */
+        particle_compositor.draw(surface.get(), dx, dy, particles, software_pal_emulation);
+    } else {
+        float const *px = particles.px(), *py = particles.py();
+        for (unsigned s = 0; s < particles.num_sets(); ++s) {
+            ParticleSet const &ps = particles.set(s);
+            unsigned char r, g, b;
+            ps.color.get_rgb(r, g, b);
+            Uint8 a = ps.life / 1000.0 * ps.opacity * 255;
+            Uint32 color = r << 24 | g << 16 | b << 8 | a << 0;
+            int size = ceil(ps.size);
+            for (unsigned i = ps.first; i < ps.first + ps.count; ++i)
+                filledDiamondColor(surface.get(), dx + px[i], dy + py[i], size, color, software_pal_emulation);
+        }
     }
     if (SDL_MUSTLOCK(surface.get()))
         SDL_UnlockSurface(surface.get());
+    dirty.add(surface->clip_rect);
 }
@@ -31,8 +31,10 @@
 
 #include "gfx/screen.hpp"
 #include "misc/deleter.hpp"
+#include "sdl/sdlparticlecompositor.hpp"
+#include "sdl/sdldirtyregion.hpp"
 
-class ParticleSet;
+class ParticleSystem;
 class GdColor;
 class PixbufFactory;
 
@@ -54,14 +56,19 @@ public:
 class SDLAbstractScreen: public Screen {
 protected:
     std::unique_ptr<SDL_Surface, Deleter<SDL_Surface, SDL_FreeSurface>> surface;
+    SDLParticleCompositor particle_compositor;
+    /// The parts of the surface drawn since the last flip. Mutable, as blit() is const.
+    mutable SDLDirtyRegion dirty;
 
 public:
     SDLAbstractScreen(PixbufFactory &pixbuf_factory): Screen(pixbuf_factory) {}
     virtual void fill_rect(int x, int y, int w, int h, const GdColor &c) override;
     virtual void blit(Pixmap const &src, int dx, int dy) const override;
+    virtual std::unique_ptr<Pixmap> create_layer(int w, int h) const override;
+    virtual void blit_to_layer(Pixmap &layer, Pixmap const &src, int dx, int dy) const override;
     virtual void set_clip_rect(int x1, int y1, int w, int h) override;
     virtual void remove_clip_rect() override;
-    virtual void draw_particle_set(int dx, int dy, ParticleSet const &ps) override;
+    virtual void draw_particles(int dx, int dy, ParticleSystem const &particles) override;
 };
 
 #endif
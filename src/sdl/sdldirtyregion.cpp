@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2007-2018, GDash Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+
+#include "sdl/sdldirtyregion.hpp"
+
+
+void SDLDirtyRegion::resize(int w_, int h_) {
+    w = w_;
+    h = h_;
+    bands.resize((h + BandHeight - 1) / BandHeight);
+    add_all();
+}
+
+
+void SDLDirtyRegion::add(SDL_Rect const &rect) {
+    int x1 = std::max(rect.x, 0), x2 = std::min(rect.x + rect.w, w) - 1;
+    int y1 = std::max(rect.y, 0), y2 = std::min(rect.y + rect.h, h) - 1;
+    if (x1 > x2 || y1 > y2)
+        return;
+    for (int b = y1 / BandHeight; b <= y2 / BandHeight; ++b) {
+        bands[b].x1 = std::min(bands[b].x1, x1);
+        bands[b].x2 = std::max(bands[b].x2, x2);
+    }
+    is_empty = false;
+}
+
+
+void SDLDirtyRegion::add_all() {
+    for (Band &band : bands) {
+        band.x1 = 0;
+        band.x2 = w - 1;
+    }
+    is_empty = bands.empty();
+}
+
+
+std::vector<SDL_Rect> const &SDLDirtyRegion::take_rects() {
+    rects.clear();
+    if (!is_empty) {
+        for (unsigned b = 0; b < bands.size(); ++b) {
+            Band &band = bands[b];
+            if (band.x1 <= band.x2) {
+                int y1 = b * BandHeight;
+                int y2 = std::min<int>(y1 + BandHeight, h);
+                /* same columns as the band above: make that rectangle taller */
+                if (!rects.empty() && rects.back().y + rects.back().h == y1
+                    && rects.back().x == band.x1 && rects.back().w == band.x2 - band.x1 + 1)
+                    rects.back().h = y2 - rects.back().y;
+                else
+                    rects.push_back(SDL_Rect { band.x1, y1, band.x2 - band.x1 + 1, y2 - y1 });
+            }
+            band.x1 = w;
+            band.x2 = -1;
+        }
+        is_empty = true;
+    }
+    return rects;
+}
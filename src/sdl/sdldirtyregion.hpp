@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2007-2018, GDash Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SDLDIRTYREGION_HPP_INCLUDED
+#define SDLDIRTYREGION_HPP_INCLUDED
+
+#include "config.h"
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+/**
+ * Collects the parts of a surface which were drawn on since the last flip,
+ * so only those need to be copied to the video card.
+ *
+ * The surface is divided into horizontal bands, and for every band the
+ * leftmost and rightmost drawn column is remembered. This is coarser than
+ * keeping every rectangle, but adding a rectangle costs only a few
+ * comparisons, and the memory used does not depend on the number of blits.
+ * When taking the region, neighbouring bands with the same columns are
+ * merged, so a full redraw is still a single rectangle.
+ */
+class SDLDirtyRegion {
+public:
+    /// Set the size of the surface tracked. The whole surface becomes dirty.
+    void resize(int w, int h);
+    /// Mark a rectangle dirty. It is clipped to the surface.
+    void add(SDL_Rect const &rect);
+    /// Mark the whole surface dirty.
+    void add_all();
+    /// Returns true if nothing was drawn since the last take_rects().
+    bool empty() const {
+        return is_empty;
+    }
+    /// Returns the dirty rectangles, and clears the region.
+    /// The vector returned is valid until the next call.
+    std::vector<SDL_Rect> const &take_rects();
+
+private:
+    enum { BandHeight = 16 };
+
+    /// The drawn columns of a band; x2 < x1 if the band is clean.
+    struct Band {
+        int x1, x2;
+    };
+
+    int w = 0, h = 0;
+    bool is_empty = true;
+    std::vector<Band> bands;
+    std::vector<SDL_Rect> rects;
+};
+
+#endif
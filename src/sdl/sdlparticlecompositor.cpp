@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2007-2018, GDash Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "sdl/sdlparticlecompositor.hpp"
+#include "cave/particle.hpp"
+#include "settings.hpp"
+
+
+#ifdef __SSE2__
+/// Blend four pixels, the components widened to 16 bits. Every component c
+/// of a pixel becomes c + ((color - c) * alpha >> 8), exactly like the line
+/// drawing of the SDL screen does; so components with zero alpha (for example
+/// the alpha channel of the surface) are left untouched.
+/// (c - p) * a >> 8 is calculated as the high word of ((c - p) << 7) * (a << 1),
+/// as both of these fit into 16 bits; the high word of the signed multiplication
+/// is rounded down, just like the arithmetic shift.
+static inline __m128i blend_4_pixels(__m128i pixels, __m128i color16, __m128i alpha16) {
+    __m128i const zero = _mm_setzero_si128();
+    __m128i lo = _mm_unpacklo_epi8(pixels, zero);
+    __m128i hi = _mm_unpackhi_epi8(pixels, zero);
+    lo = _mm_add_epi16(lo, _mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(color16, lo), 7), alpha16));
+    hi = _mm_add_epi16(hi, _mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(color16, hi), 7), alpha16));
+    return _mm_packus_epi16(lo, hi);
+}
+
+
+/// Blend a horizontal run of pixels.
+static void blend_span(Uint32 *pixels, int count, Uint32 color, Uint32 alpha) {
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const color16 = _mm_unpacklo_epi8(_mm_set1_epi32(color), zero);
+    __m128i const alpha16 = _mm_slli_epi16(_mm_unpacklo_epi8(_mm_set1_epi32(alpha), zero), 1);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i *p = reinterpret_cast<__m128i *>(pixels + i);
+        _mm_storeu_si128(p, blend_4_pixels(_mm_loadu_si128(p), color16, alpha16));
+    }
+    if (i + 2 <= count) {
+        __m128i *p = reinterpret_cast<__m128i *>(pixels + i);
+        _mm_storel_epi64(p, blend_4_pixels(_mm_loadl_epi64(p), color16, alpha16));
+        i += 2;
+    }
+    if (i < count)
+        pixels[i] = _mm_cvtsi128_si32(blend_4_pixels(_mm_cvtsi32_si128(pixels[i]), color16, alpha16));
+}
+#else
+/// Blend a component of a pixel; the one at the given bit position.
+static inline Uint32 blend_component(Uint32 pixel, Uint32 color, Uint32 alpha, int shift) {
+    int p = (pixel >> shift) & 0xff, c = (color >> shift) & 0xff, a = (alpha >> shift) & 0xff;
+    return Uint32(p + ((c - p) * a >> 8)) << shift;
+}
+
+
+/// Blend one pixel, exactly like the line drawing of the SDL screen does: every
+/// component c of the pixel becomes c + ((color - c) * alpha >> 8). Components
+/// with zero alpha (for example the alpha channel of the surface) are left untouched.
+static inline Uint32 blend_pixel(Uint32 pixel, Uint32 color, Uint32 alpha) {
+    return blend_component(pixel, color, alpha, 0) | blend_component(pixel, color, alpha, 8)
+           | blend_component(pixel, color, alpha, 16) | blend_component(pixel, color, alpha, 24);
+}
+
+
+/// Blend a horizontal run of pixels.
+static void blend_span(Uint32 *pixels, int count, Uint32 color, Uint32 alpha) {
+    for (int i = 0; i < count; ++i)
+        pixels[i] = blend_pixel(pixels[i], color, alpha);
+}
+#endif
+
+
+bool SDLParticleCompositor::can_draw(SDL_Surface const *surface) {
+    SDL_PixelFormat const *format = surface->format;
+    if (format->BytesPerPixel != 4)
+        return false;
+    return format->Rmask == Uint32(0xff) << format->Rshift && format->Rshift % 8 == 0
+           && format->Gmask == Uint32(0xff) << format->Gshift && format->Gshift % 8 == 0
+           && format->Bmask == Uint32(0xff) << format->Bshift && format->Bshift % 8 == 0;
+}
+
+
+void SDLParticleCompositor::draw(SDL_Surface *surface, int dx, int dy, ParticleSystem const &particles, bool pal_emulation) {
+    SDL_Rect const &clip = surface->clip_rect;
+    if (clip.w <= 0 || clip.h <= 0)
+        return;
+    int const clip_x2 = clip.x + clip.w - 1, clip_y2 = clip.y + clip.h - 1;
+    SDL_PixelFormat const *format = surface->format;
+
+    /* collect the visible particles, and the colors of the sets. the conversions
+     * of the coordinates and the colors are the same as in the line drawing routine. */
+    colors.resize(particles.num_sets());
+    diamonds.clear();
+    float const *px = particles.px(), *py = particles.py();
+    for (unsigned s = 0; s < particles.num_sets(); ++s) {
+        ParticleSet const &ps = particles.set(s);
+        unsigned char r, g, b;
+        ps.color.get_rgb(r, g, b);
+        Uint8 a = ps.life / 1000.0 * ps.opacity * 255;
+        Uint8 a_odd = pal_emulation ? a * gd_pal_emu_scanline_shade / 100 : a;
+        colors[s].color = r << format->Rshift | g << format->Gshift | b << format->Bshift;
+        colors[s].alpha = a << format->Rshift | a << format->Gshift | a << format->Bshift;
+        colors[s].alpha_odd = a_odd << format->Rshift | a_odd << format->Gshift | a_odd << format->Bshift;
+
+        Sint16 size = ceil(ps.size);
+        if (size < 0 || (colors[s].alpha == 0 && colors[s].alpha_odd == 0))
+            continue;   /* invisible */
+        for (unsigned i = ps.first; i < ps.first + ps.count; ++i) {
+            Sint16 x = dx + px[i], y = dy + py[i];
+            if (x + size < clip.x || x - size > clip_x2 || y + size < clip.y || y - size > clip_y2)
+                continue;
+            diamonds.push_back(Diamond {x, y, size, s});
+        }
+    }
+    if (diamonds.empty())
+        return;
+
+    /* sort the diamonds into the tiles they touch. this is a counting sort,
+     * so the order of the diamonds in every tile remains the order of drawing. */
+    int const tiles_w = (clip.w + TileSize - 1) / TileSize;
+    int const tiles_h = (clip.h + TileSize - 1) / TileSize;
+    /* the first and the last tile touched by the coordinates c-r..c+r, clipped to min..max */
+    auto tile_range = [](int c, int r, int min, int max) {
+        return std::make_pair((std::max(c - r, min) - min) / TileSize, (std::min(c + r, max) - min) / TileSize);
+    };
+    tile_start.assign(tiles_w * tiles_h + 1, 0);
+    for (Diamond const &d : diamonds) {
+        auto tx = tile_range(d.x, d.r, clip.x, clip_x2);
+        auto ty = tile_range(d.y, d.r, clip.y, clip_y2);
+        for (int y = ty.first; y <= ty.second; ++y)
+            for (int x = tx.first; x <= tx.second; ++x)
+                tile_start[y * tiles_w + x + 1]++;
+    }
+    for (int t = 0; t < tiles_w * tiles_h; ++t)
+        tile_start[t + 1] += tile_start[t];
+    tile_fill.assign(tile_start.begin(), tile_start.end() - 1);
+    tile_diamonds.resize(tile_start.back());
+    for (unsigned i = 0; i < diamonds.size(); ++i) {
+        Diamond const &d = diamonds[i];
+        auto tx = tile_range(d.x, d.r, clip.x, clip_x2);
+        auto ty = tile_range(d.y, d.r, clip.y, clip_y2);
+        for (int y = ty.first; y <= ty.second; ++y)
+            for (int x = tx.first; x <= tx.second; ++x)
+                tile_diamonds[tile_fill[y * tiles_w + x]++] = i;
+    }
+
+    /* draw the tiles. a diamond of radius r has rows of half width r-|y-yc|. */
+    for (int ty = 0; ty < tiles_h; ++ty) {
+        int const y1 = clip.y + ty * TileSize, y2 = std::min(y1 + TileSize - 1, clip_y2);
+        for (int tx = 0; tx < tiles_w; ++tx) {
+            int const x1 = clip.x + tx * TileSize, x2 = std::min(x1 + TileSize - 1, clip_x2);
+            int const tile = ty * tiles_w + tx;
+            for (unsigned k = tile_start[tile]; k < tile_start[tile + 1]; ++k) {
+                Diamond const &d = diamonds[tile_diamonds[k]];
+                SetColor const &c = colors[d.set];
+                for (int y = std::max(d.y - d.r, y1); y <= std::min(d.y + d.r, y2); ++y) {
+                    int const half = d.r - abs(y - d.y);
+                    int const xa = std::max(d.x - half, x1), xb = std::min(d.x + half, x2);
+                    if (xa > xb)
+                        continue;
+                    Uint32 *row = reinterpret_cast<Uint32 *>(static_cast<Uint8 *>(surface->pixels) + y * surface->pitch);
+                    blend_span(row + xa, xb - xa + 1, c.color, y % 2 == 1 ? c.alpha_odd : c.alpha);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2007-2018, GDash Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SDLPARTICLECOMPOSITOR_HPP_INCLUDED
+#define SDLPARTICLECOMPOSITOR_HPP_INCLUDED
+
+#include "config.h"
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+class ParticleSystem;
+
+/**
+ * Draws all the particles of a frame onto a 32-bit SDL surface.
+ *
+ * The particles are collected first, and sorted into tiles of the surface,
+ * keeping their order inside every tile. Then the tiles are drawn one by one,
+ * so the pixels touched are close to each other in memory. The blending gives
+ * exactly the same result as drawing the particles one by one, and uses SSE2
+ * if available. The buffers are kept between frames, so after the first few
+ * frames no memory is allocated.
+ */
+class SDLParticleCompositor {
+public:
+    /// Returns true if the surface has a pixel format which can be drawn on:
+    /// 32 bits per pixel, with 8 bits for every color component.
+    static bool can_draw(SDL_Surface const *surface);
+    /// Draw the particles. The surface must be locked if needed.
+    /// @param surface The surface to draw on.
+    /// @param dx The screen coordinates of the cave origin.
+    /// @param dy The screen coordinates of the cave origin.
+    /// @param particles The particles to draw; their coordinates must already be normalized.
+    /// @param pal_emulation Shade the odd rows, like the software PAL emulation does.
+    void draw(SDL_Surface *surface, int dx, int dy, ParticleSystem const &particles, bool pal_emulation);
+
+private:
+    enum { TileSize = 64 };
+
+    /// A particle on the screen.
+    struct Diamond {
+        int x, y;           ///< Center
+        int r;              ///< Radius
+        unsigned set;       ///< Index of the particle set, to find the color
+    };
+    /// The color of a particle set, as pixels of the surface.
+    struct SetColor {
+        Uint32 color;       ///< The color, in the format of the surface
+        Uint32 alpha;       ///< The opacity, in every color component of the pixel
+        Uint32 alpha_odd;   ///< The opacity for odd rows, with PAL emulation
+    };
+
+    std::vector<SetColor> colors;
+    std::vector<Diamond> diamonds;
+    std::vector<unsigned> tile_start;       ///< For every tile, the index of its first diamond in tile_diamonds
+    std::vector<unsigned> tile_fill;        ///< For every tile, the place of its next diamond in tile_diamonds, while sorting
+    std::vector<unsigned> tile_diamonds;    ///< Indexes of the diamonds, sorted by the tiles
+};
+
+#endif
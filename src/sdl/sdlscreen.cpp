@@ -55,6 +55,7 @@ void SDLScreen::configure_size() {
 
     /* create screen */
     surface.reset(SDL_CreateRGBSurface(0, w, h, 32, Pixbuf::rmask, Pixbuf::gmask, Pixbuf::bmask, Pixbuf::amask));
+    dirty.resize(w, h);
     if (gd_fullscreen)
         window.reset(SDL_CreateWindow("", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 0, 0, SDL_WINDOW_FULLSCREEN_DESKTOP));
     else
@@ -89,7 +90,11 @@ bool SDLScreen::must_redraw_all_before_flip() const {
 
 
 void SDLScreen::flip() {
-    SDL_UpdateTexture(texture.get(), NULL, surface->pixels, surface->w * sizeof(Uint32));
+    /* only update the parts of the texture which were drawn since the last flip */
+    for (SDL_Rect const &r : dirty.take_rects()) {
+        Uint8 const *pixels = (Uint8 const *) surface->pixels + r.y * surface->pitch + r.x * sizeof(Uint32);
+        SDL_UpdateTexture(texture.get(), &r, pixels, surface->pitch);
+    }
     SDL_RenderClear(renderer.get());
     SDL_RenderCopy(renderer.get(), texture.get(), NULL, NULL);
     SDL_RenderPresent(renderer.get());